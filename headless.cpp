@@ -0,0 +1,447 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+
+#include "src/TuringMachine/turingMachine.hpp"
+#include "src/TuringMachine/macroMachine.hpp"
+#include "src/TuringMachine/cycleDetector.hpp"
+#include "src/TuringMachine/batchRunner.hpp"
+#include "src/TuringMachine/enumerator.hpp"
+#include "src/TuringMachine/transpiler.hpp"
+#include "src/TuringMachine/checkpoint.hpp"
+#include "src/TuringMachine/programFormat.hpp"
+
+// Headless batch runner: loads a .javaturing machine, runs it at full
+// interpreter speed with no per-step I/O and prints one JSON object of
+// final statistics. With --batch, runs a whole job list on all cores and
+// prints one JSON object per job; with --enumerate, runs every n-state
+// machine over an alphabet. Builds without FLTK.
+
+using std::cout;
+using std::cerr;
+using std::endl;
+using std::string;
+
+static void usage(const char* prog){
+    cerr << "usage: " << prog << " <machine.javaturing> [--steps N] [--tape-limit N] [--no-sweep] [--macro K] [--detect-cycles] [--engine E] [--packed | --tape-file F]" << endl
+         << "           [--checkpoint F [--checkpoint-interval S]] [--resume F] [--dump-tape]" << endl
+         << "       " << prog << " <machine.javaturing> --emit-cpp <out.cpp> | --emit-sd <out.sd> | --emit-program <out.tmp>" << endl
+         << "       " << prog << " --batch <jobs.txt> [--threads N] [--steps N] [--tape-limit N] [--detect-cycles]" << endl
+         << "       " << prog << " --enumerate N [--symbols S_,S1] [--threads N] [--steps N] [--tape-limit N] [--detect-cycles] [--halting-only]" << endl
+         << "  --steps N        step budget (default 100000000, 100000 per machine when enumerating)" << endl
+         << "  --tape-limit N   stop once the tape spans N cells (default 1000000)" << endl
+         << "  --no-sweep       step sweep transitions one cell at a time" << endl
+         << "  --macro K        simulate blocks of K cells with a transition cache (1-12)" << endl
+         << "  --detect-cycles  stop early on exact or translated cycles (non-halting)" << endl
+         << "  --engine E       step loop: table (default) or threaded (computed-goto dispatch)" << endl
+         << "  --packed         store the tape at 2, 4 or 5 bits per cell" << endl
+         << "  --tape-file F    keep the tape in a memory-mapped file F, left behind as a tape image" << endl
+         << "  --tape-reserve N cells reserved either side of cell 0 in the tape file (default 2^36)" << endl
+         << "  --checkpoint F   write a binary checkpoint to F every interval and at the end" << endl
+         << "  --checkpoint-interval S  seconds between checkpoints (default 60)" << endl
+         << "  --resume F       continue from checkpoint F; --steps still counts from the original start," << endl
+         << "                   and checkpointing to another file forks the run" << endl
+         << "  --dump-tape      print the tape's cells after the report" << endl
+         << "  --emit-cpp FILE  translate the machine to standalone C++ instead of running it" << endl
+         << "  --emit-sd FILE   write the machine's standard description instead of running it" << endl
+         << "  --emit-program FILE  write the machine in the compact binary format instead of running it" << endl
+         << "  A machine file may be .javaturing text, a standard description (DADDCRDAA...)," << endl
+         << "  a description number (31332531...) or the binary format." << endl
+         << "  --batch FILE     run every job in FILE, one per line:" << endl
+         << "                     <machine> [steps=N] [tape-limit=N] [tape=S1,S0,...] [detect-cycles]" << endl
+         << "  --threads N      batch worker threads (default: all cores)" << endl
+         << "  --enumerate N    run every N-state machine in tree normal form from a blank tape" << endl
+         << "  --symbols LIST   alphabet to enumerate over, blank first (default S_,S1)" << endl
+         << "  --halting-only   only print enumerated machines that halt" << endl;
+}
+
+static bool parseCount(const char* text, uint64_t& out){
+    char* end = nullptr;
+    unsigned long long value = strtoull(text, &end, 10);
+    if (end == text || *end != '\0'){
+        return false;
+    }
+    out = value;
+    return true;
+}
+
+static int runBatch(const string& jobFile, unsigned threads, const BatchJob& defaults){
+    fstream file(jobFile);
+    if (!file.is_open()) {
+        cerr << "Failed to open file: " << jobFile << endl;
+        return 1;
+    }
+    vector<BatchJob> jobs;
+    try{
+        jobs = BatchRunner::parseJobs(file, defaults);
+    }
+    catch (const std::invalid_argument& e){
+        cerr << jobFile << ": " << e.what() << endl;
+        return 1;
+    }
+
+    BatchRunner runner(threads);
+    auto start = std::chrono::steady_clock::now();
+    vector<BatchResult> results = runner.run(jobs);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    uint64_t totalSteps = 0;
+    for (const BatchResult& r : results){
+        cout << toJson(r) << '\n';
+        totalSteps += r.run.steps;
+    }
+    cout << "{\"jobs\":" << results.size()
+         << ",\"threads\":" << runner.threads()
+         << ",\"total_steps\":" << totalSteps
+         << ",\"wall_seconds\":" << seconds
+         << ",\"steps_per_second\":" << (uint64_t)(seconds > 0 ? totalSteps / seconds : 0)
+         << "}" << endl;
+    return 0;
+}
+
+static int runEnumeration(const EnumerationOptions& options, unsigned threads, bool haltingOnly){
+    uint64_t counts[5] = {0, 0, 0, 0, 0};
+    uint64_t bestSteps = 0;
+    uint64_t bestMarks = 0;
+    string bestStepsMachine;
+    string bestMarksMachine;
+
+    auto start = std::chrono::steady_clock::now();
+    Enumerator enumerator(options, threads);
+    enumerator.run([&](const Candidate& c){
+        counts[(int)c.run.reason]++;
+        bool halted = c.run.reason == HaltReason::Halted;
+        if (halted && c.run.steps > bestSteps){
+            bestSteps = c.run.steps;
+            bestStepsMachine = programText(c.program);
+        }
+        if (halted && c.marks > bestMarks){
+            bestMarks = c.marks;
+            bestMarksMachine = programText(c.program);
+        }
+        if (haltingOnly && !halted){return;}
+        string sd = standardDescription(c.program);
+        cout << "{\"machine\":\"" << jsonEscape(programText(c.program)) << "\""
+             << ",\"sd\":\"" << sd << "\""
+             << ",\"sd_number\":\"" << sdNumber(sd) << "\""
+             << ",\"steps\":" << c.run.steps
+             << ",\"halt_reason\":\"" << haltReasonName(c.run.reason) << "\""
+             << ",\"cells\":" << c.cells
+             << ",\"marks\":" << c.marks
+             << "}\n";
+    });
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    cout << "{\"states\":" << options.states
+         << ",\"symbols\":" << options.symbols.size()
+         << ",\"threads\":" << enumerator.threads()
+         << ",\"machines\":" << enumerator.machineCount()
+         << ",\"pruned\":" << enumerator.prunedCount();
+    for (HaltReason reason : {HaltReason::Halted, HaltReason::Undefined, HaltReason::StepLimit, HaltReason::TapeLimit, HaltReason::NonHalting}){
+        cout << ",\"" << haltReasonName(reason) << "\":" << counts[(int)reason];
+    }
+    cout << ",\"max_steps\":" << bestSteps
+         << ",\"max_steps_machine\":\"" << jsonEscape(bestStepsMachine) << "\""
+         << ",\"max_marks\":" << bestMarks
+         << ",\"max_marks_machine\":\"" << jsonEscape(bestMarksMachine) << "\""
+         << ",\"wall_seconds\":" << seconds
+         << "}" << endl;
+    return 0;
+}
+
+// C++ namespace for a machine's generated code, from its file name
+static string namespaceFor(const string& path){
+    string stem = path.substr(path.find_last_of('/') + 1);
+    stem = stem.substr(0, stem.find('.'));
+    string ns = "tm_";
+    for (char c : stem){
+        ns += isalnum((unsigned char)c) ? c : '_';
+    }
+    return ns;
+}
+
+int main(int argc, const char* argv[]) {
+    string path;
+    uint64_t maxSteps = 100000000;
+    uint64_t tapeLimit = 1000000;
+    bool sweeps = true;
+    uint64_t macroBlock = 0;
+    bool detectCycles = false;
+    string jobFile;
+    uint64_t threads = std::thread::hardware_concurrency();
+    uint64_t enumerateStates = 0;
+    string symbols = "S_,S1";
+    bool stepsGiven = false;
+    bool tapeLimitGiven = false;
+    bool haltingOnly = false;
+    bool dumpTape = false;
+    string emitPath;
+    string emitSDPath;
+    string emitProgramPath;
+    Engine engine = Engine::Table;
+    bool packed = false;
+    string tapeFile;
+    uint64_t tapeReserve = uint64_t(1) << 36;
+    string checkpointPath;
+    double checkpointInterval = 60;
+    string resumePath;
+
+    for (int i = 1; i < argc; i++){
+        string arg = argv[i];
+        if (arg == "--steps" && i + 1 < argc){
+            if (!parseCount(argv[++i], maxSteps)){usage(argv[0]); return 2;}
+            stepsGiven = true;
+        }
+        else if (arg == "--tape-limit" && i + 1 < argc){
+            if (!parseCount(argv[++i], tapeLimit)){usage(argv[0]); return 2;}
+            tapeLimitGiven = true;
+        }
+        else if (arg == "--macro" && i + 1 < argc){
+            if (!parseCount(argv[++i], macroBlock) || macroBlock == 0 || macroBlock > MacroMachine::MAX_BLOCK){usage(argv[0]); return 2;}
+        }
+        else if (arg == "--batch" && i + 1 < argc){
+            jobFile = argv[++i];
+        }
+        else if (arg == "--threads" && i + 1 < argc){
+            if (!parseCount(argv[++i], threads) || threads == 0){usage(argv[0]); return 2;}
+        }
+        else if (arg == "--enumerate" && i + 1 < argc){
+            if (!parseCount(argv[++i], enumerateStates) || enumerateStates == 0){usage(argv[0]); return 2;}
+        }
+        else if (arg == "--symbols" && i + 1 < argc){
+            symbols = argv[++i];
+        }
+        else if (arg == "--emit-cpp" && i + 1 < argc){
+            emitPath = argv[++i];
+        }
+        else if (arg == "--emit-sd" && i + 1 < argc){
+            emitSDPath = argv[++i];
+        }
+        else if (arg == "--emit-program" && i + 1 < argc){
+            emitProgramPath = argv[++i];
+        }
+        else if (arg == "--engine" && i + 1 < argc){
+            string name = argv[++i];
+            if (name == "table"){engine = Engine::Table;}
+            else if (name == "threaded"){engine = Engine::Threaded;}
+            else{usage(argv[0]); return 2;}
+        }
+        else if (arg == "--tape-file" && i + 1 < argc){
+            tapeFile = argv[++i];
+        }
+        else if (arg == "--tape-reserve" && i + 1 < argc){
+            if (!parseCount(argv[++i], tapeReserve) || tapeReserve == 0){usage(argv[0]); return 2;}
+        }
+        else if (arg == "--checkpoint" && i + 1 < argc){
+            checkpointPath = argv[++i];
+        }
+        else if (arg == "--checkpoint-interval" && i + 1 < argc){
+            char* end = nullptr;
+            checkpointInterval = strtod(argv[++i], &end);
+            if (*end != '\0' || !(checkpointInterval >= 0)){usage(argv[0]); return 2;}
+        }
+        else if (arg == "--resume" && i + 1 < argc){
+            resumePath = argv[++i];
+        }
+        else if (arg == "--packed"){
+            packed = true;
+        }
+        else if (arg == "--dump-tape"){
+            dumpTape = true;
+        }
+        else if (arg == "--halting-only"){
+            haltingOnly = true;
+        }
+        else if (arg == "--detect-cycles"){
+            detectCycles = true;
+        }
+        else if (arg == "--no-sweep"){
+            sweeps = false;
+        }
+        else if (path.empty() && arg[0] != '-'){
+            path = arg;
+        }
+        else{
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (enumerateStates > 0 && path.empty() && jobFile.empty()){
+        EnumerationOptions options;
+        options.states = enumerateStates;
+        options.symbols.clear();
+        for (const string& name : split(symbols, ',')){
+            if (toSym.count(name) == 0){
+                cerr << "Unknown symbol: " << name << endl;
+                return 2;
+            }
+            options.symbols.push_back(toSym.at(name));
+        }
+        if (stepsGiven){options.maxSteps = maxSteps;}
+        if (tapeLimitGiven){options.tapeLimit = tapeLimit;}
+        options.detectCycles = detectCycles;
+        try{
+            return runEnumeration(options, threads, haltingOnly);
+        }
+        catch (const std::invalid_argument& e){
+            cerr << e.what() << endl;
+            return 2;
+        }
+    }
+    if (!jobFile.empty() && path.empty()){
+        BatchJob defaults;
+        defaults.maxSteps = maxSteps;
+        defaults.tapeLimit = tapeLimit;
+        defaults.detectCycles = detectCycles;
+        return runBatch(jobFile, threads, defaults);
+    }
+    if (path.empty() || !jobFile.empty() || enumerateStates > 0){
+        usage(argv[0]);
+        return 2;
+    }
+
+    Tape tape;
+    TM* machine;
+    try{
+        machine = loadMachine(path, tape, tapeLimit);
+    }
+    catch (const std::runtime_error& e){
+        cerr << e.what() << endl;
+        return 1;
+    }
+    catch (const std::invalid_argument& e){
+        cerr << path << ": " << e.what() << endl;
+        return 1;
+    }
+
+    if (!emitPath.empty() || !emitSDPath.empty() || !emitProgramPath.empty()){
+        // each requested translation, then exit without running
+        vector<std::pair<string, string>> outputs;
+        if (!emitPath.empty()){
+            outputs.emplace_back(emitPath, Transpiler(*machine->getProgram(), path, namespaceFor(path)).generate());
+        }
+        if (!emitSDPath.empty()){
+            outputs.emplace_back(emitSDPath, machine->getFullSD() + "\n");
+        }
+        if (!emitProgramPath.empty()){
+            outputs.emplace_back(emitProgramPath, encodeProgram(*machine->getProgram()));
+        }
+        delete machine;
+        for (const auto& [outPath, content] : outputs){
+            std::ofstream generated(outPath, std::ios::binary);
+            generated << content;
+            if (!generated){
+                cerr << "Failed to write file: " << outPath << endl;
+                return 1;
+            }
+        }
+        return 0;
+    }
+
+    // engine-specific fields, appended to the report
+    stringstream extra;
+    if ((packed && !tapeFile.empty()) || (!checkpointPath.empty() && (detectCycles || macroBlock > 0))){
+        usage(argv[0]);
+        delete machine;
+        return 2;
+    }
+    BatchResult report;
+    report.machine = path;
+
+    // the tape is rebuilt before any packing or mapping is applied to it
+    if (!resumePath.empty()){
+        try{
+            uint32_t state;
+            report.startStep = restoreSnapshot(resumePath, *machine->getProgram(), tape, state);
+            machine->setState(state);
+        }
+        catch (const std::runtime_error& e){
+            cerr << e.what() << endl;
+            delete machine;
+            return 1;
+        }
+    }
+    uint64_t budget = maxSteps - std::min(maxSteps, report.startStep);
+    if (packed){
+        extra << ",\"packed_bits\":" << machine->packTape();
+    }
+    if (!tapeFile.empty()){
+        try{
+            tape.mapFile(tapeFile, tapeReserve);
+        }
+        catch (const std::exception& e){
+            cerr << e.what() << endl;
+            delete machine;
+            return 1;
+        }
+        extra << ",\"tape_file\":\"" << jsonEscape(tapeFile) << "\"";
+    }
+    auto start = std::chrono::steady_clock::now();
+    RunResult& result = report.run;
+    try{
+        if (detectCycles){
+            CycleDetector detector(*machine->getProgram());
+            uint32_t state = machine->getState();
+            result = detector.run(tape, state, budget, tapeLimit);
+            machine->setState(state);
+            report.cycle = detector.getVerdict();
+        }
+        else if (macroBlock > 0){
+            MacroMachine macro(*machine->getProgram(), macroBlock);
+            uint32_t state = machine->getState();
+            result = macro.run(tape, state, budget, tapeLimit);
+            machine->setState(state);
+            extra << ",\"macro_block\":" << macroBlock
+                  << ",\"macro_cache_entries\":" << macro.cacheSize()
+                  << ",\"macro_hits\":" << macro.hits
+                  << ",\"macro_misses\":" << macro.misses;
+        }
+        else if (!checkpointPath.empty()){
+            machine->setEngine(engine);
+            CheckpointWriter writer(checkpointPath);
+            uint64_t steps = report.startStep;
+            result = runWithCheckpoints(*machine, tape, steps, maxSteps, sweeps, writer, checkpointInterval);
+            extra << ",\"checkpoints_written\":" << writer.checkpointsWritten();
+            if (!writer.lastError().empty()){
+                extra << ",\"checkpoint_error\":\"" << jsonEscape(writer.lastError()) << "\"";
+            }
+        }
+        else{
+            machine->setEngine(engine);
+            result = machine->runHeadless(budget, sweeps);
+        }
+        if (engine == Engine::Threaded && !detectCycles && macroBlock == 0){
+            extra << ",\"engine\":\"threaded\"";
+        }
+        result.steps += report.startStep;
+    }
+    catch (const std::length_error& e){
+        // a file-backed tape ran out of reserve
+        report.error = e.what();
+        cout << toJson(report) << endl;
+        delete machine;
+        return 1;
+    }
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    report.state = machine->currentStateName();
+    report.tapeSize = tape.getSize();
+    report.leftEdge = tape.getLeftEdge();
+    report.rightEdge = tape.getRightEdge();
+    report.head = tape.getHead();
+    if (packed){
+        extra << ",\"tape_bytes\":" << tape.memoryUsed();
+    }
+    cout << toJson(report, extra.str()) << endl;
+    if (dumpTape){
+        for (int64_t i = tape.getLeftEdge(); i <= tape.getRightEdge(); i++){
+            cout << symToChar[tape.readAt(i)];
+        }
+        cout << endl;
+    }
+
+    delete machine;
+    return 0;
+}
@@ -5,8 +5,8 @@
 #include <string>
 #include <random>
 
-#include "/Users/benmeyers/Desktop/turingViz/src/TuringMachine/turingMachine.hpp"
-#include "/Users/benmeyers/Desktop/turingViz/src/graphics/graphics.h"
+#include "src/TuringMachine/turingMachine.hpp"
+#include "src/graphics/graphics.h"
 
 
 using std::cout;
@@ -19,7 +19,8 @@ using std::string;
 
 int main(int argc, const char* argv[]) {
 
-    fstream file("/Users/benmeyers/Desktop/turingViz/src/TuringMachine/doubling.javaturing");
+    string path = argc > 1 ? argv[1] : "src/TuringMachine/doubling.javaturing";
+    fstream file(path);
     if (!file.is_open()) {
         std::cerr << "Failed to open file" << std::endl;
         return 1;
@@ -29,7 +30,11 @@ int main(int argc, const char* argv[]) {
     
     TM* counting = TM::fromStandardDescription(file, tape, 999);
     
-    counting->runStepWiseWindow();
+    if (argc > 2 && string(argv[2]) == "--space-time") {
+        counting->runSpaceTimeWindow();
+    } else {
+        counting->runStepWiseWindow();
+    }
     
     cout << tape << endl;
 
@@ -37,4 +42,4 @@ int main(int argc, const char* argv[]) {
 	cout << "Final head position: " << tape.getHead() << endl;
 
     return 0;
-}
\ No newline at end of file
+}
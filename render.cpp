@@ -0,0 +1,196 @@
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+
+#include "src/TuringMachine/turingMachine.hpp"
+#include "src/TuringMachine/programFormat.hpp"
+#include "src/graphics/graphics.h"
+
+// Batch renderer: draws the visualization of a run offscreen with the
+// software graphics backend and writes it out as numbered PNG or PPM
+// frames, encoded on all cores, or streams the run's space-time diagram
+// into a single image. Builds without FLTK.
+
+using std::cout;
+using std::cerr;
+using std::endl;
+using std::string;
+
+// widest space-time diagram --cells can be left out for
+static const uint64_t MAX_SPACE_TIME_CELLS = 16384;
+
+static void usage(const char* prog){
+    cerr << "usage: " << prog << " <machine.javaturing> --out PATTERN [--steps-per-frame N] [--frames N] [--size WxH] [--threads N] [--tape-limit N] [--overview FIRST:N]" << endl
+         << "       " << prog << " <machine.javaturing> --space-time FILE [--steps-per-row N] [--rows N] [--cells FIRST:N] [--scale N] [--by-symbol] [--tape-limit N]" << endl
+         << "  --out PATTERN        frame files, with one %d (or %06d...) for the frame number;" << endl
+         << "                       .ppm writes PPM, anything else PNG" << endl
+         << "  --steps-per-frame N  steps between frames (default 1)" << endl
+         << "  --frames N           stop after N frames (default 1000)" << endl
+         << "  --size WxH           frame size in pixels (default 1503x810)" << endl
+         << "  --threads N          encoder threads (default: all cores)" << endl
+         << "  --tape-limit N       stop once the tape spans N cells (default 1000000)" << endl
+         << "  --overview FIRST:N   show cells FIRST to FIRST+N-1 in the whole-tape overview (default: all)" << endl
+         << "  --space-time FILE    write the space-time diagram, a row of cells per sample, to FILE;" << endl
+         << "                       .ppm writes PPM, anything else PNG" << endl
+         << "  --steps-per-row N    steps between rows (default 1)" << endl
+         << "  --rows N             stop after N rows (default 100000)" << endl
+         << "  --cells FIRST:N      cells FIRST to FIRST+N-1 (default: all the run visits, up to " << MAX_SPACE_TIME_CELLS << ")" << endl
+         << "  --scale N            pixels per cell, across and down (default 1)" << endl
+         << "  --by-symbol          color cells by symbol rather than by the configuration that wrote them" << endl;
+}
+
+static bool parseCount(const char* text, uint64_t& out){
+    char* end = nullptr;
+    unsigned long long value = strtoull(text, &end, 10);
+    if (end == text || *end != '\0'){
+        return false;
+    }
+    out = value;
+    return true;
+}
+
+// FIRST:N, with N at least 1
+static bool parseRange(const string& text, int64_t& first, uint64_t& count){
+    size_t colon = text.find(':');
+    char* end = nullptr;
+    first = strtoll(text.c_str(), &end, 10);
+    return colon != string::npos && end == text.c_str() + colon && parseCount(text.c_str() + colon + 1, count) && count > 0;
+}
+
+int main(int argc, char* argv[]){
+    string path;
+    string pattern;
+    uint64_t stepsPerFrame = 1;
+    uint64_t frames = 1000;
+    uint64_t width = 1503;
+    uint64_t height = 810;
+    uint64_t threads = 0;
+    uint64_t tapeLimit = 1000000;
+    int64_t overviewFirst = 0;
+    uint64_t overviewCells = 0;
+    string spaceTimePath;
+    uint64_t stepsPerRow = 1;
+    uint64_t rows = 100000;
+    int64_t cellsFirst = 0;
+    uint64_t cells = 0;
+    uint64_t scale = 1;
+    TM::SpaceTimeColors colors = TM::SpaceTimeColors::ByStain;
+
+    for (int i = 1; i < argc; i++){
+        string arg = argv[i];
+        if (arg == "--out" && i + 1 < argc){
+            pattern = argv[++i];
+        }
+        else if (arg == "--steps-per-frame" && i + 1 < argc){
+            if (!parseCount(argv[++i], stepsPerFrame) || stepsPerFrame == 0){usage(argv[0]); return 2;}
+        }
+        else if (arg == "--frames" && i + 1 < argc){
+            if (!parseCount(argv[++i], frames) || frames == 0){usage(argv[0]); return 2;}
+        }
+        else if (arg == "--size" && i + 1 < argc){
+            string size = argv[++i];
+            size_t x = size.find('x');
+            if (x == string::npos || !parseCount(size.substr(0, x).c_str(), width) || !parseCount(size.substr(x + 1).c_str(), height)
+                || width < 100 || height < 100 || width > 16384 || height > 16384){
+                usage(argv[0]);
+                return 2;
+            }
+        }
+        else if (arg == "--threads" && i + 1 < argc){
+            if (!parseCount(argv[++i], threads) || threads == 0){usage(argv[0]); return 2;}
+        }
+        else if (arg == "--tape-limit" && i + 1 < argc){
+            if (!parseCount(argv[++i], tapeLimit)){usage(argv[0]); return 2;}
+        }
+        else if (arg == "--overview" && i + 1 < argc){
+            if (!parseRange(argv[++i], overviewFirst, overviewCells)){usage(argv[0]); return 2;}
+        }
+        else if (arg == "--space-time" && i + 1 < argc){
+            spaceTimePath = argv[++i];
+        }
+        else if (arg == "--steps-per-row" && i + 1 < argc){
+            if (!parseCount(argv[++i], stepsPerRow) || stepsPerRow == 0){usage(argv[0]); return 2;}
+        }
+        else if (arg == "--rows" && i + 1 < argc){
+            if (!parseCount(argv[++i], rows) || rows == 0){usage(argv[0]); return 2;}
+        }
+        else if (arg == "--cells" && i + 1 < argc){
+            if (!parseRange(argv[++i], cellsFirst, cells) || cells > 1000000){usage(argv[0]); return 2;}
+        }
+        else if (arg == "--scale" && i + 1 < argc){
+            if (!parseCount(argv[++i], scale) || scale == 0 || scale > 64){usage(argv[0]); return 2;}
+        }
+        else if (arg == "--by-symbol"){
+            colors = TM::SpaceTimeColors::BySymbol;
+        }
+        else if (path.empty() && arg[0] != '-'){
+            path = arg;
+        }
+        else{
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (path.empty() || pattern.empty() == spaceTimePath.empty()){
+        usage(argv[0]);
+        return 2;
+    }
+
+    Tape tape;
+    std::unique_ptr<TM> machine;
+    try{
+        machine.reset(loadMachine(path, tape, tapeLimit));
+    }
+    catch (const std::runtime_error& e){
+        cerr << e.what() << endl;
+        return 1;
+    }
+    catch (const std::invalid_argument& e){
+        cerr << path << ": " << e.what() << endl;
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t steps;
+    if (!spaceTimePath.empty()){
+        if (cells == 0){
+            // the cells the run visits, from a trial run on a tape of its own
+            Tape trialTape;
+            std::unique_ptr<TM> trial(loadMachine(path, trialTape, tapeLimit));
+            trial->runHeadless(rows * stepsPerRow);
+            cellsFirst = trialTape.getLeftEdge();
+            cells = trialTape.getRightEdge() - trialTape.getLeftEdge() + 1;
+            if (cells > MAX_SPACE_TIME_CELLS){
+                cerr << "The run visits " << cells << " cells; pick which to draw with --cells FIRST:N" << endl;
+                return 1;
+            }
+        }
+        try{
+            steps = machine->exportSpaceTime(spaceTimePath, rows, stepsPerRow, colors, cellsFirst, cells, scale);
+        }
+        catch (const graphics::ErrorException& e){
+            cerr << e.what() << endl;
+            return 1;
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        cout << "Drew " << steps << " steps in " << seconds << " s, ending in state " << machine->currentStateName() << endl;
+        return 0;
+    }
+    try{
+        graphics::Window window(width, height, path);
+        window.recordFrames(pattern, threads);
+        machine->setOverview(overviewFirst, overviewCells);
+        steps = machine->renderFrames(window, stepsPerFrame, frames);
+        // waits for the last frames to be written
+        window.recordFrames("");
+    }
+    catch (const graphics::ErrorException& e){
+        cerr << e.what() << endl;
+        return 1;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    cout << "Rendered " << steps << " steps in " << seconds << " s, ending in state " << machine->currentStateName() << endl;
+    return 0;
+}
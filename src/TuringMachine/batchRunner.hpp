@@ -0,0 +1,241 @@
+#pragma once
+
+#include <chrono>
+#include <map>
+
+#include "turingMachine.hpp"
+#include "cycleDetector.hpp"
+#include "threadPool.hpp"
+#include "programFormat.hpp"
+
+inline vector<string> split(const string& str, char delimiter) {
+    vector<string> tokens;
+    stringstream ss(str);
+    string token;
+    while (getline(ss, token, delimiter)) {
+        tokens.push_back(token);
+    }
+    return tokens;
+}
+
+inline void trim(string &s) {
+    s.erase(s.begin(), find_if(s.begin(), s.end(), [](unsigned char ch) {
+        return !isspace(ch);
+    }));
+    rtrim(s);
+}
+
+// One machine run in a batch.
+struct BatchJob{
+    string machine;                 // .javaturing path
+    vector<Symbol> initialTape;     // written from cell 0 onwards
+    uint64_t maxSteps = 100000000;
+    uint64_t tapeLimit = 1000000;
+    bool detectCycles = false;
+};
+
+struct BatchResult{
+    size_t job = 0;
+    string machine;
+    string error;                   // set if the machine could not be loaded
+    RunResult run = {0, HaltReason::Halted};
+    uint64_t startStep = 0;         // steps taken before this run, when resumed from a checkpoint
+    string state;
+    uint64_t tapeSize = 0;
+    int64_t leftEdge = 0;
+    int64_t rightEdge = 0;
+    int64_t head = 0;
+    double seconds = 0;
+    CycleDetector::Verdict cycle;
+};
+
+inline string jsonEscape(const string& s){
+    stringstream ss;
+    for (char c : s){
+        if (c == '"' || c == '\\'){
+            ss << '\\' << c;
+        }
+        else if ((unsigned char)c < 0x20){
+            ss << ' ';
+        }
+        else{
+            ss << c;
+        }
+    }
+    return ss.str();
+}
+
+// One-line JSON report; extra is spliced in before the closing brace.
+inline string toJson(const BatchResult& r, const string& extra = ""){
+    stringstream ss;
+    ss << "{\"machine\":\"" << jsonEscape(r.machine) << "\"";
+    if (!r.error.empty()){
+        ss << ",\"error\":\"" << jsonEscape(r.error) << "\"}";
+        return ss.str();
+    }
+    ss << ",\"steps\":" << r.run.steps
+       << ",\"halt_reason\":\"" << haltReasonName(r.run.reason) << "\""
+       << ",\"state\":\"" << jsonEscape(r.state) << "\""
+       << ",\"tape_size\":" << r.tapeSize
+       << ",\"left_edge\":" << r.leftEdge
+       << ",\"right_edge\":" << r.rightEdge
+       << ",\"head\":" << r.head
+       << ",\"wall_seconds\":" << r.seconds
+       << ",\"steps_per_second\":" << (uint64_t)(r.seconds > 0 ? (r.run.steps - r.startStep) / r.seconds : 0);
+    if (r.startStep > 0){
+        ss << ",\"resumed_at\":" << r.startStep;
+    }
+    if (r.cycle.found){
+        ss << ",\"cycle_kind\":\"" << (r.cycle.translated ? "translated" : "exact") << "\""
+           << ",\"cycle_period\":" << r.cycle.period
+           << ",\"cycle_shift\":" << r.cycle.shift;
+    }
+    ss << extra << "}";
+    return ss.str();
+}
+
+// Runs many machines at once on a work-stealing pool. Each distinct
+// machine file is parsed once and its compiled Program is shared,
+// read-only, by every job that uses it; each job gets its own Tape.
+class BatchRunner{
+
+    private:
+
+    ThreadPool pool;
+
+    static std::shared_ptr<const Program> load(const string& path, string& error){
+        Tape scratch;
+        try{
+            std::unique_ptr<TM> machine(loadMachine(path, scratch, 0));
+            return machine->getProgram();
+        }
+        catch (const std::exception& e){
+            error = e.what();
+        }
+        return nullptr;
+    }
+
+    public:
+
+    explicit BatchRunner(unsigned threads = std::thread::hardware_concurrency()) : pool(threads) {}
+
+    unsigned threads() const {
+        return pool.size();
+    }
+
+    static BatchResult runOne(const Program& prog, const BatchJob& job){
+        BatchResult result;
+        result.machine = job.machine;
+
+        Tape tape(std::max<size_t>(54, job.initialTape.size()));
+        for (size_t i = 0; i < job.initialTape.size(); i++){
+            tape.writeAt(i, job.initialTape[i]);
+        }
+        uint32_t state = prog.start;
+
+        auto start = std::chrono::steady_clock::now();
+        if (job.detectCycles){
+            CycleDetector detector(prog);
+            result.run = detector.run(tape, state, job.maxSteps, job.tapeLimit);
+            result.cycle = detector.getVerdict();
+        }
+        else{
+            result.run = execute(prog, tape, state, job.maxSteps, job.tapeLimit);
+        }
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        result.state = prog.nameOf(state);
+        result.tapeSize = tape.getSize();
+        result.leftEdge = tape.getLeftEdge();
+        result.rightEdge = tape.getRightEdge();
+        result.head = tape.getHead();
+        return result;
+    }
+
+    // Results come back in job order.
+    vector<BatchResult> run(const vector<BatchJob>& jobs){
+        std::map<string, std::shared_ptr<const Program>> programs;
+        std::map<string, string> errors;
+        for (const BatchJob& job : jobs){
+            if (programs.count(job.machine) == 0 && errors.count(job.machine) == 0){
+                string error;
+                std::shared_ptr<const Program> prog = load(job.machine, error);
+                if (prog){
+                    programs.emplace(job.machine, prog);
+                }
+                else{
+                    errors.emplace(job.machine, error);
+                }
+            }
+        }
+
+        vector<BatchResult> results(jobs.size());
+        for (size_t i = 0; i < jobs.size(); i++){
+            results[i].job = i;
+            results[i].machine = jobs[i].machine;
+            auto found = programs.find(jobs[i].machine);
+            if (found == programs.end()){
+                results[i].error = errors.at(jobs[i].machine);
+                continue;
+            }
+            std::shared_ptr<const Program> prog = found->second;
+            const BatchJob* job = &jobs[i];
+            BatchResult* slot = &results[i];
+            pool.submit([prog, job, slot, i]{
+                *slot = runOne(*prog, *job);
+                slot->job = i;
+            });
+        }
+        pool.wait();
+        return results;
+    }
+
+    // Job list, one job per line:
+    //   <machine.javaturing> [steps=N] [tape-limit=N] [tape=S1,S0,...] [detect-cycles]
+    // Blank lines and lines starting with # are skipped; missing settings
+    // come from defaults.
+    static vector<BatchJob> parseJobs(std::istream& in, const BatchJob& defaults){
+        vector<BatchJob> jobs;
+        string line;
+        unsigned lineNo = 0;
+        while (getline(in, line)){
+            lineNo++;
+            trim(line);
+            if (line.empty() || line[0] == '#'){continue;}
+
+            stringstream words(line);
+            BatchJob job = defaults;
+            words >> job.machine;
+            string word;
+            while (words >> word){
+                size_t eq = word.find('=');
+                string key = word.substr(0, eq);
+                string value = eq == string::npos ? "" : word.substr(eq + 1);
+                try{
+                    if (key == "steps"){
+                        job.maxSteps = std::stoull(value);
+                    }
+                    else if (key == "tape-limit"){
+                        job.tapeLimit = std::stoull(value);
+                    }
+                    else if (key == "tape"){
+                        for (const string& name : split(value, ',')){
+                            job.initialTape.push_back(toSym.at(name));
+                        }
+                    }
+                    else if (key == "detect-cycles"){
+                        job.detectCycles = true;
+                    }
+                    else{
+                        throw std::invalid_argument(key);
+                    }
+                }
+                catch (const std::exception&){
+                    throw std::invalid_argument("job list line " + std::to_string(lineNo) + ": bad setting '" + word + "'");
+                }
+            }
+            jobs.push_back(job);
+        }
+        return jobs;
+    }
+};
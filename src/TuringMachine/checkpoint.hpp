@@ -0,0 +1,285 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstdio>
+
+#include "turingMachine.hpp"
+
+// Binary checkpoints of a running machine: state, step count, head, the
+// tape's cells and its stains. The layout is a CheckpointHeader followed by
+// the sections it gives offsets for; everything is little-endian and read
+// back through a memory map with no parsing.
+//
+//   state name      stateNameBytes bytes
+//   cells           rightEdge - leftEdge + 1 bytes, one Symbol each
+//   stains          stainCount records of int64_t cell, uint32_t Tape::Stain
+struct CheckpointHeader{
+    char magic[8];              // "TMCKPT2"
+    uint64_t programHash;       // of programText(), checked on resume
+    uint64_t steps;
+    int64_t head;
+    int64_t leftEdge;
+    int64_t rightEdge;
+    uint32_t fill;
+    uint32_t stateNameBytes;
+    uint64_t stateNameOffset;
+    uint64_t cellsOffset;
+    uint64_t stainsOffset;
+    uint64_t stainCount;
+};
+
+// A machine's execution state copied out of the step loop, ready to be
+// written while the run goes on.
+struct Snapshot{
+    uint64_t programHash = 0;
+    uint64_t steps = 0;
+    string stateName;
+    int64_t head = 0;
+    int64_t leftEdge = 0;
+    int64_t rightEdge = 0;
+    Symbol fill = S_;
+    vector<uint8_t> cells;
+    vector<std::pair<int64_t, uint32_t>> stains;
+};
+
+inline uint64_t programHash(const Program& prog){
+    // FNV-1a
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (char c : programText(prog)){
+        hash = (hash ^ (uint8_t)c) * 0x100000001B3ull;
+    }
+    return hash;
+}
+
+inline Snapshot captureSnapshot(const Program& prog, const Tape& tape, uint32_t state, uint64_t steps){
+    Snapshot snap;
+    snap.programHash = programHash(prog);
+    snap.steps = steps;
+    snap.stateName = prog.nameOf(state);
+    snap.head = tape.getHead();
+    snap.leftEdge = tape.getLeftEdge();
+    snap.rightEdge = tape.getRightEdge();
+    snap.fill = tape.getFill();
+    snap.cells.resize(tape.getSize());
+    tape.unpack(snap.leftEdge, snap.cells.size(), snap.cells.data());
+    tape.forEachStain([&](int64_t cell, Tape::Stain stain){
+        snap.stains.emplace_back(cell, stain);
+    });
+    return snap;
+}
+
+// Writes snap to path + ".tmp" and renames it over path, so a crash
+// mid-write leaves the previous checkpoint in place.
+inline void writeSnapshot(const Snapshot& snap, const string& path){
+    CheckpointHeader header = {};
+    memcpy(header.magic, "TMCKPT2", 8);
+    header.programHash = snap.programHash;
+    header.steps = snap.steps;
+    header.head = snap.head;
+    header.leftEdge = snap.leftEdge;
+    header.rightEdge = snap.rightEdge;
+    header.fill = snap.fill;
+    header.stateNameBytes = snap.stateName.size();
+    header.stateNameOffset = sizeof(CheckpointHeader);
+    header.cellsOffset = header.stateNameOffset + snap.stateName.size();
+    header.stainsOffset = header.cellsOffset + snap.cells.size();
+    header.stainCount = snap.stains.size();
+
+    string tmp = path + ".tmp";
+    std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+    out.write((const char*)&header, sizeof(header));
+    out.write(snap.stateName.data(), snap.stateName.size());
+    out.write((const char*)snap.cells.data(), snap.cells.size());
+    for (const auto& [cell, stain] : snap.stains){
+        out.write((const char*)&cell, sizeof(cell));
+        out.write((const char*)&stain, sizeof(stain));
+    }
+    out.close();
+    if (!out || std::rename(tmp.c_str(), path.c_str()) != 0){
+        throw std::runtime_error("Failed to write checkpoint: " + path);
+    }
+}
+
+// Loads the checkpoint at path into tape and state, for prog. Returns the
+// step count it was taken at. Throws std::runtime_error if the file is
+// not a checkpoint of prog.
+inline uint64_t restoreSnapshot(const string& path, const Program& prog, Tape& tape, uint32_t& state){
+    MappedFile file(path);
+    const uint8_t* data = (const uint8_t*)file.view().data();
+    size_t size = file.view().size();
+
+    CheckpointHeader header;
+    if (size < sizeof(header)){
+        throw std::runtime_error("Not a checkpoint: " + path);
+    }
+    memcpy(&header, data, sizeof(header));
+    // count records of recordBytes at offset lie within the file, checked
+    // without any sum or product that could overflow
+    auto fits = [size](uint64_t offset, uint64_t count, uint64_t recordBytes){
+        return offset <= size && count <= (size - offset) / recordBytes;
+    };
+    uint64_t cellCount = (uint64_t)header.rightEdge - (uint64_t)header.leftEdge + 1;
+    // a tape starts on cell 0 and only ever grows, with the head inside it
+    if (memcmp(header.magic, "TMCKPT2", 8) != 0 || header.leftEdge > 0 || header.rightEdge < 0
+        || header.head < header.leftEdge || header.head > header.rightEdge || cellCount == 0
+        || !fits(header.stateNameOffset, header.stateNameBytes, 1) || !fits(header.cellsOffset, cellCount, 1)
+        || !fits(header.stainsOffset, header.stainCount, 12) || header.fill >= Program::NUM_SYMBOLS){
+        throw std::runtime_error("Not a checkpoint: " + path);
+    }
+    if (header.programHash != programHash(prog)){
+        throw std::runtime_error("Checkpoint was taken from a different machine: " + path);
+    }
+
+    string stateName((const char*)data + header.stateNameOffset, header.stateNameBytes);
+    if (stateName == "HALT"){
+        state = Program::HALT_ID;
+    }
+    else{
+        auto found = std::find(prog.stateNames.begin(), prog.stateNames.end(), stateName);
+        if (found == prog.stateNames.end()){
+            throw std::runtime_error("Checkpoint names an unknown state: " + stateName);
+        }
+        state = found - prog.stateNames.begin();
+    }
+
+    const uint8_t* cells = data + header.cellsOffset;
+    if (std::any_of(cells, cells + cellCount, [](uint8_t cell){return cell >= Program::NUM_SYMBOLS;})){
+        throw std::runtime_error("Not a checkpoint: " + path);
+    }
+    tape = Tape(1, symToName[header.fill]);
+    tape.load(header.leftEdge, cells, cellCount);
+    tape.reach(header.leftEdge, header.rightEdge);
+    tape.moveTo(header.head);
+
+    const uint8_t* p = data + header.stainsOffset;
+    for (uint64_t i = 0; i < header.stainCount; i++){
+        int64_t cell;
+        uint32_t stain;
+        memcpy(&cell, p, sizeof(cell));
+        memcpy(&stain, p + sizeof(cell), sizeof(stain));
+        if (cell < header.leftEdge || cell > header.rightEdge || stain > std::numeric_limits<Tape::Stain>::max()){
+            throw std::runtime_error("Not a checkpoint: " + path);
+        }
+        tape.stain(cell, stain);
+        p += sizeof(cell) + sizeof(stain);
+    }
+    return header.steps;
+}
+
+// Writes snapshots on a background thread so the step loop only pays for
+// copying the tape out. If a new snapshot arrives before the last one is
+// on disk, the older one is dropped.
+class CheckpointWriter{
+
+    private:
+
+    string path;
+    std::mutex lock;
+    std::condition_variable wake;
+    std::unique_ptr<Snapshot> pending;
+    bool busy = false;
+    bool stopping = false;
+    uint64_t written = 0;
+    string error;
+    std::thread worker;         // last, so it starts after everything it uses
+
+    void work(){
+        std::unique_lock<std::mutex> guard(lock);
+        while (true){
+            wake.wait(guard, [this]{ return pending || stopping; });
+            if (!pending){
+                return;
+            }
+            std::unique_ptr<Snapshot> snap = std::move(pending);
+            busy = true;
+            guard.unlock();
+            string failure;
+            try{
+                writeSnapshot(*snap, path);
+            }
+            catch (const std::exception& e){
+                failure = e.what();
+            }
+            guard.lock();
+            busy = false;
+            if (failure.empty()){
+                written++;
+            }
+            else{
+                error = failure;
+            }
+            wake.notify_all();
+        }
+    }
+
+    public:
+
+    explicit CheckpointWriter(const string& p) : path(p) {
+        worker = std::thread(&CheckpointWriter::work, this);
+    }
+
+    ~CheckpointWriter(){
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopping = true;
+        }
+        wake.notify_all();
+        worker.join();
+    }
+
+    void submit(Snapshot snap){
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            pending = std::make_unique<Snapshot>(std::move(snap));
+        }
+        wake.notify_all();
+    }
+
+    // blocks until everything submitted is on disk
+    void flush(){
+        std::unique_lock<std::mutex> guard(lock);
+        wake.wait(guard, [this]{ return !pending && !busy; });
+    }
+
+    uint64_t checkpointsWritten(){
+        std::lock_guard<std::mutex> guard(lock);
+        return written;
+    }
+
+    // last write failure, if any
+    string lastError(){
+        std::lock_guard<std::mutex> guard(lock);
+        return error;
+    }
+};
+
+// Runs machine in slices of sliceSteps, handing a snapshot to writer each
+// time intervalSeconds have passed and once more at the end. steps is the
+// step count so far and is kept up to date; maxSteps counts from the
+// machine's original start. The result covers this call's steps only.
+inline RunResult runWithCheckpoints(TM& machine, Tape& tape, uint64_t& steps, uint64_t maxSteps, bool sweeps,
+                                    CheckpointWriter& writer, double intervalSeconds, uint64_t sliceSteps = 1 << 24){
+    const Program& prog = *machine.getProgram();
+    auto lastCheckpoint = std::chrono::steady_clock::now();
+    RunResult total = {0, HaltReason::StepLimit};
+    do{
+        RunResult slice = machine.runHeadless(std::min(sliceSteps, maxSteps - std::min(steps, maxSteps)), sweeps);
+        steps += slice.steps;
+        total.steps += slice.steps;
+        total.reason = slice.reason;
+        if (slice.reason != HaltReason::StepLimit){
+            break;
+        }
+        auto now = std::chrono::steady_clock::now();
+        if (std::chrono::duration<double>(now - lastCheckpoint).count() >= intervalSeconds){
+            writer.submit(captureSnapshot(prog, tape, machine.getState(), steps));
+            lastCheckpoint = now;
+        }
+    } while (steps < maxSteps);
+    writer.submit(captureSnapshot(prog, tape, machine.getState(), steps));
+    writer.flush();
+    return total;
+}
@@ -0,0 +1,233 @@
+#pragma once
+
+#include "turingMachine.hpp"
+
+// Opt-in step engine that proves a machine never halts by catching its
+// configuration repeating, either exactly or shifted along the tape.
+//
+// Exact cycles: a Zobrist fingerprint of the tape is kept up to date on
+// every write and compared, together with state and head, against a
+// checkpoint re-taken at steps 1, 2, 4, 8, ... (Brent). A fingerprint hit is
+// confirmed cell by cell before it is believed.
+//
+// Translated cycles: at each step where the head reaches a new rightmost
+// (leftmost) cell, the state and the tape behind the head are compared with
+// the last checkpointed record in that direction. If the state matches and
+// the cells the head has read since then, shifted by the distance between
+// the records, are unchanged, the run will repeat that stretch forever.
+//
+// Memory is bounded: each checkpoint keeps at most MAX_WINDOW cells, and
+// checkpoints whose window would be larger just don't get compared.
+class CycleDetector{
+
+    public:
+
+    static const int64_t MAX_WINDOW = 1 << 16;
+
+    struct Verdict{
+        bool found = false;
+        bool translated = false;
+        uint64_t period = 0;    // steps per repetition
+        int64_t shift = 0;      // cells the pattern moves per repetition
+        uint64_t provenAt = 0;  // step at which the cycle was confirmed
+    };
+
+    private:
+
+    struct Checkpoint{
+        bool valid = false;
+        uint64_t step = 0;
+        uint32_t state = 0;
+        int64_t head = 0;
+        uint64_t fingerprint = 0;
+        int64_t first = 0;          // cells[i] is the tape at first + i
+        vector<uint8_t> cells;
+    };
+
+    const Program& prog;
+    Verdict verdict;
+
+    uint64_t fingerprint = 0;
+    Checkpoint exact;
+    uint64_t nextExact = 1;
+
+    Checkpoint rightRecord;
+    Checkpoint leftRecord;
+    uint64_t nextRight = 1;
+    uint64_t nextLeft = 1;
+    int64_t lowestSinceRight = 0;   // leftmost head position since rightRecord
+    int64_t highestSinceLeft = 0;   // rightmost head position since leftRecord
+
+    static uint64_t mix(uint64_t x){
+        x += 0x9E3779B97F4A7C15ull;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+        return x ^ (x >> 31);
+    }
+
+    // contribution of one cell; blank (fill) cells contribute nothing
+    static uint64_t zobrist(int64_t cell, Symbol s, Symbol fill){
+        return s == fill ? 0 : mix((uint64_t)cell * 32 + s);
+    }
+
+    static void save(Checkpoint& cp, const Tape& tape, uint64_t step, uint32_t state, uint64_t fp, int64_t from, int64_t to){
+        cp.step = step;
+        cp.state = state;
+        cp.head = tape.getHead();
+        cp.fingerprint = fp;
+        cp.valid = to - from + 1 <= MAX_WINDOW;
+        cp.cells.clear();
+        if (cp.valid){
+            cp.first = from;
+            for (int64_t i = from; i <= to; i++){
+                cp.cells.push_back(tape.readAt(i));
+            }
+        }
+    }
+
+    static Symbol savedAt(const Checkpoint& cp, int64_t i, Symbol fill){
+        return i >= cp.first && i < cp.first + (int64_t)cp.cells.size() ? (Symbol)cp.cells[i - cp.first] : fill;
+    }
+
+    // cells (head, rightEdge] or [leftEdge, head) are all blank
+    static bool clearBeyond(const Tape& tape, uint8_t direction){
+        int64_t from = direction == RIGHT ? tape.getHead() + 1 : tape.getLeftEdge();
+        int64_t to = direction == RIGHT ? tape.getRightEdge() : tape.getHead() - 1;
+        for (int64_t i = from; i <= to; i++){
+            if (tape.readAt(i) != tape.getFill()){return false;}
+        }
+        return true;
+    }
+
+    bool sameTape(const Checkpoint& cp, const Tape& tape) const {
+        int64_t from = std::min(cp.first, tape.getLeftEdge());
+        int64_t to = std::max(cp.first + (int64_t)cp.cells.size() - 1, tape.getRightEdge());
+        for (int64_t i = from; i <= to; i++){
+            if (tape.readAt(i) != savedAt(cp, i, tape.getFill())){return false;}
+        }
+        return true;
+    }
+
+    // The head is on a new record cell in direction, in the same state as
+    // the checkpointed record; reached is the farthest the head has been
+    // back the other way since. The stretch read since then repeats if it
+    // held the same cells, shifted, when the checkpoint was taken.
+    bool repeatsShifted(const Checkpoint& cp, const Tape& tape, int64_t reached, uint8_t direction) const {
+        int64_t shift = tape.getHead() - cp.head;
+        int64_t from = direction == RIGHT ? reached : cp.head;
+        int64_t to = direction == RIGHT ? cp.head : reached;
+        if (from < cp.first || to >= cp.first + (int64_t)cp.cells.size()){
+            return false;
+        }
+        for (int64_t i = from; i <= to; i++){
+            if (tape.readAt(i + shift) != cp.cells[i - cp.first]){return false;}
+        }
+        return true;
+    }
+
+    void onRecord(const Tape& tape, uint64_t step, uint32_t state, uint8_t direction){
+        Checkpoint& cp = direction == RIGHT ? rightRecord : leftRecord;
+        uint64_t& next = direction == RIGHT ? nextRight : nextLeft;
+        int64_t& reached = direction == RIGHT ? lowestSinceRight : highestSinceLeft;
+
+        if (!clearBeyond(tape, direction)){
+            return;
+        }
+        if (cp.valid && cp.state == state && repeatsShifted(cp, tape, reached, direction)){
+            verdict.found = true;
+            verdict.translated = true;
+            verdict.period = step - cp.step;
+            verdict.shift = tape.getHead() - cp.head;
+            verdict.provenAt = step;
+            return;
+        }
+        if (step >= next){
+            int64_t from = direction == RIGHT ? std::max(tape.getLeftEdge(), tape.getHead() - MAX_WINDOW + 1) : tape.getHead();
+            int64_t to = direction == RIGHT ? tape.getHead() : std::min(tape.getRightEdge(), tape.getHead() + MAX_WINDOW - 1);
+            save(cp, tape, step, state, 0, from, to);
+            reached = tape.getHead();
+            next = 2 * step;
+        }
+    }
+
+    public:
+
+    CycleDetector(const Program& p) : prog(p) {}
+
+    const Verdict& getVerdict() const {
+        return verdict;
+    }
+
+    // Same contract as execute(), but stops with HaltReason::NonHalting as
+    // soon as a cycle is proven. Sweeps are stepped one cell at a time so
+    // every configuration is seen.
+    RunResult run(Tape& tape, uint32_t& state, uint64_t maxSteps, uint64_t tapeLimit){
+        const Symbol fill = tape.getFill();
+        fingerprint = 0;
+        for (int64_t i = tape.getLeftEdge(); i <= tape.getRightEdge(); i++){
+            fingerprint ^= zobrist(i, tape.readAt(i), fill);
+        }
+        save(exact, tape, 0, state, fingerprint, tape.getLeftEdge(), tape.getRightEdge());
+        int64_t lowest = tape.getHead();
+        int64_t highest = tape.getHead();
+        lowestSinceRight = highestSinceLeft = tape.getHead();
+
+        uint64_t steps = 0;
+        while (true){
+            if (state == Program::HALT_ID){
+                return {steps, HaltReason::Halted};
+            }
+            if (tape.getSize() >= tapeLimit){
+                return {steps, HaltReason::TapeLimit};
+            }
+            if (steps == maxSteps){
+                return {steps, HaltReason::StepLimit};
+            }
+            Symbol read = tape.read();
+            const Program::Transition& transition = prog.at(state, read);
+            if (transition.next == Program::UNDEFINED_ID){
+                return {steps, HaltReason::Undefined};
+            }
+
+            if (transition.write != read){
+                fingerprint ^= zobrist(tape.getHead(), read, fill) ^ zobrist(tape.getHead(), (Symbol)transition.write, fill);
+                tape.write((Symbol)transition.write);
+            }
+            if (transition.move == LEFT){
+                tape.left();
+            }
+            else if (transition.move == RIGHT){
+                tape.right();
+            }
+            state = transition.next;
+            steps++;
+
+            int64_t headPos = tape.getHead();
+            lowestSinceRight = std::min(lowestSinceRight, headPos);
+            highestSinceLeft = std::max(highestSinceLeft, headPos);
+
+            if (exact.valid && state == exact.state && headPos == exact.head && fingerprint == exact.fingerprint && sameTape(exact, tape)){
+                verdict.found = true;
+                verdict.period = steps - exact.step;
+                verdict.provenAt = steps;
+                return {steps, HaltReason::NonHalting};
+            }
+            if (steps >= nextExact){
+                save(exact, tape, steps, state, fingerprint, tape.getLeftEdge(), tape.getRightEdge());
+                nextExact = 2 * steps;
+            }
+
+            if (headPos > highest){
+                highest = headPos;
+                onRecord(tape, steps, state, RIGHT);
+            }
+            else if (headPos < lowest){
+                lowest = headPos;
+                onRecord(tape, steps, state, LEFT);
+            }
+            if (verdict.found){
+                return {steps, HaltReason::NonHalting};
+            }
+        }
+    }
+};
@@ -0,0 +1,192 @@
+#pragma once
+
+#include <mutex>
+#include <functional>
+
+#include "turingMachine.hpp"
+#include "cycleDetector.hpp"
+#include "threadPool.hpp"
+
+struct EnumerationOptions{
+    unsigned states = 2;
+    vector<Symbol> symbols = {S_, S1};  // symbols[0] is the blank and must be S_
+    uint64_t maxSteps = 100000;
+    uint64_t tapeLimit = 100000;
+    bool detectCycles = false;
+};
+
+// One enumerated machine and how its run from a blank tape ended.
+struct Candidate{
+    const Program& program;     // transitions never reached are left undefined
+    RunResult run;
+    uint64_t cells;             // tape cells visited
+    uint64_t marks;             // non-blank cells left on the tape
+};
+
+// Enumerates every n-state machine over an alphabet in tree normal form:
+// machines are grown one transition at a time, each new transition filled
+// in only when a run first reaches it. That skips every machine that
+// differs from another only in
+//   - transitions its run never uses,
+//   - the naming of its states (states are numbered in order of first use),
+//   - the naming of its non-blank symbols (likewise, in alphabet order),
+//   - left/right mirroring (the first move is always to the right).
+// Whenever a run reaches an undefined transition, one child halts there
+// (writing the first non-blank symbol and moving right, the usual "1RH")
+// and the others continue with every other admissible transition.
+// Subtrees near the root become pool tasks; deeper ones run inline.
+class Enumerator{
+
+    public:
+
+    // transitions defined before a subtree is explored inline instead of
+    // being handed to the pool
+    static const unsigned SPAWN_DEPTH = 4;
+
+    private:
+
+    struct Node{
+        Program prog;
+        unsigned usedStates;    // states 0 .. usedStates-1 have been referenced
+        unsigned usedSymbols;   // symbols[0 .. usedSymbols-1] have been written
+        unsigned defined;       // transitions filled in so far
+    };
+
+    EnumerationOptions options;
+    ThreadPool pool;
+    std::function<void(const Candidate&)> sink;
+    std::mutex sinkLock;
+    std::atomic<uint64_t> machines{0};
+    std::atomic<uint64_t> pruned{0};
+
+    void record(const Program& prog, const Tape& tape, RunResult run){
+        uint64_t marks = 0;
+        for (int64_t i = tape.getLeftEdge(); i <= tape.getRightEdge(); i++){
+            marks += tape.readAt(i) != options.symbols[0];
+        }
+        machines++;
+        std::lock_guard<std::mutex> guard(sinkLock);
+        sink(Candidate{prog, run, tape.getSize(), marks});
+    }
+
+    static void define(Node& node, uint32_t state, Symbol read, Program::Transition t){
+        node.prog.table[state * Program::NUM_SYMBOLS + read] = t;
+        node.prog.findSweeps();
+        node.defined++;
+    }
+
+    void explore(const Node& node){
+        // one tape per worker, reset for every run
+        thread_local Tape tape(1);
+        tape.reset(1);
+
+        uint32_t state = node.prog.start;
+        RunResult result;
+        if (options.detectCycles){
+            CycleDetector detector(node.prog);
+            result = detector.run(tape, state, options.maxSteps, options.tapeLimit);
+        }
+        else{
+            result = execute(node.prog, tape, state, options.maxSteps, options.tapeLimit);
+        }
+        if (result.reason != HaltReason::Undefined){
+            record(node.prog, tape, result);
+            return;
+        }
+
+        Symbol read = tape.read();
+        unsigned k = options.symbols.size();
+
+        // the halting child finishes on this tape, so it goes first
+        Node halted = node;
+        Symbol mark = options.symbols[std::min(1u, k - 1)];
+        define(halted, state, read, {Program::HALT_ID, (uint8_t)mark, RIGHT, 0});
+        tape.write(mark);
+        tape.right();
+        // halting is checked before the tape limit, as in execute()
+        record(halted.prog, tape, {result.steps + 1, HaltReason::Halted});
+
+        unsigned maxNext = std::min(node.usedStates, options.states - 1);
+        unsigned maxWrite = std::min(node.usedSymbols, k - 1);
+        for (uint32_t next = 0; next <= maxNext; next++){
+            for (unsigned write = 0; write <= maxWrite; write++){
+                for (uint8_t move : {RIGHT, LEFT}){
+                    if (node.defined == 0 && (move == LEFT || (next == 0 && options.states > 1))){
+                        // the mirror image of a right-first machine, or one
+                        // that walks right over blanks forever
+                        pruned++;
+                        continue;
+                    }
+                    Node child = node;
+                    define(child, state, read, {next, (uint8_t)options.symbols[write], move, 0});
+                    child.usedStates = std::max(node.usedStates, next + 1);
+                    child.usedSymbols = std::max(node.usedSymbols, write + 1);
+                    if (child.defined <= SPAWN_DEPTH){
+                        pool.submit([this, child]{ explore(child); });
+                    }
+                    else{
+                        explore(child);
+                    }
+                }
+            }
+        }
+    }
+
+    public:
+
+    Enumerator(const EnumerationOptions& opts, unsigned threads = std::thread::hardware_concurrency()) : options(opts), pool(threads) {
+        if (options.states == 0 || options.states > 26){
+            throw std::invalid_argument("State count must be between 1 and 26");
+        }
+        if (options.symbols.empty() || options.symbols[0] != S_){
+            throw std::invalid_argument("Alphabet must start with the blank S_");
+        }
+        for (size_t i = 0; i < options.symbols.size(); i++){
+            for (size_t j = 0; j < i; j++){
+                if (options.symbols[i] == options.symbols[j]){
+                    throw std::invalid_argument("Alphabet lists a symbol twice");
+                }
+            }
+        }
+    }
+
+    unsigned threads() const {
+        return pool.size();
+    }
+
+    // Machines reported so far, and machines skipped at the root as mirror
+    // images or certain non-halters (each standing for a whole subtree).
+    uint64_t machineCount() const {
+        return machines;
+    }
+
+    uint64_t prunedCount() const {
+        return pruned;
+    }
+
+    // Runs the whole enumeration, handing every leaf machine to onMachine.
+    // Calls are serialized but come from worker threads, in no fixed order.
+    void run(std::function<void(const Candidate&)> onMachine){
+        sink = std::move(onMachine);
+        machines = 0;
+        pruned = 0;
+
+        Node root;
+        root.prog.stateNames.resize(options.states);
+        for (unsigned i = 0; i < options.states; i++){
+            root.prog.stateNames[i] = string(1, 'A' + i);
+        }
+        root.prog.table.assign(options.states * Program::NUM_SYMBOLS, Program::Transition());
+        for (unsigned i = 0; i < root.prog.table.size(); i++){
+            root.prog.table[i] = {Program::UNDEFINED_ID, (uint8_t)(i % Program::NUM_SYMBOLS), NONE, 0};
+        }
+        root.prog.findSweeps();
+        root.prog.start = 0;
+        root.usedStates = 1;
+        root.usedSymbols = 1;
+        root.defined = 0;
+
+        pool.submit([this, root]{ explore(root); });
+        pool.wait();
+    }
+};
@@ -0,0 +1,221 @@
+#pragma once
+
+#include "turingMachine.hpp"
+
+// Block-level simulator layered on a compiled Program. The tape is treated
+// as aligned blocks of k cells; whenever the head sits on the edge of a
+// block, the basic steps taken until it leaves that block are looked up in
+// a cache keyed by (state, block contents, entry side) and applied in one
+// go. Step counts, final tapes and stop reasons are the same as execute().
+class MacroMachine{
+
+    public:
+
+    // symbols are packed 5 bits each into a 64-bit block
+    static const unsigned MAX_BLOCK = 12;
+    // basic steps simulated inside one block before giving up on it
+    static const uint64_t INNER_LIMIT = 1 << 20;
+
+    private:
+
+    enum Exit : uint8_t{
+        EXIT_LEFT, EXIT_RIGHT, EXIT_HALT, EXIT_UNDEFINED, EXIT_NONE
+    };
+
+    struct Key{
+        uint64_t block;
+        uint32_t state;
+        uint8_t side;   // LEFT if the head is on the block's first cell, RIGHT if on its last
+
+        bool operator==(const Key& other) const {
+            return block == other.block && state == other.state && side == other.side;
+        }
+    };
+
+    static uint64_t hashOf(const Key& key){
+        uint64_t h = key.block * 0x9E3779B97F4A7C15ull;
+        h ^= ((uint64_t)key.state << 1 | key.side) + 0x632BE59BD9B4E019ull + (h << 6) + (h >> 2);
+        return h ^ (h >> 31);
+    }
+
+    struct Outcome{
+        uint64_t block;     // contents when the head leaves (or stops inside)
+        uint64_t steps;     // basic steps taken
+        uint32_t state;     // state on leaving
+        uint8_t exit;
+        uint8_t offset;     // where the head stopped, for EXIT_HALT / EXIT_UNDEFINED
+    };
+
+    struct Entry{
+        Key key;
+        Outcome outcome;
+        bool used;
+    };
+
+    const Program& prog;
+    unsigned k;
+    // open-addressed, linear probing; kept at most half full
+    vector<Entry> cache;
+    size_t entries = 0;
+
+    void grow(){
+        vector<Entry> old;
+        old.swap(cache);
+        cache.assign(old.empty() ? 1024 : old.size() * 2, Entry());
+        entries = 0;
+        for (const Entry& e : old){
+            if (e.used){
+                insert(e.key, e.outcome);
+            }
+        }
+    }
+
+    const Outcome* find(const Key& key) const {
+        size_t mask = cache.size() - 1;
+        for (size_t i = hashOf(key) & mask; cache[i].used; i = (i + 1) & mask){
+            if (cache[i].key == key){
+                return &cache[i].outcome;
+            }
+        }
+        return nullptr;
+    }
+
+    const Outcome* insert(const Key& key, const Outcome& outcome){
+        if (2 * (entries + 1) > cache.size()){
+            grow();
+        }
+        size_t mask = cache.size() - 1;
+        size_t i = hashOf(key) & mask;
+        while (cache[i].used){
+            i = (i + 1) & mask;
+        }
+        cache[i] = {key, outcome, true};
+        entries++;
+        return &cache[i].outcome;
+    }
+
+    static Symbol cellOf(uint64_t block, unsigned i){
+        return (Symbol)((block >> (5 * i)) & 31);
+    }
+
+    static uint64_t withCell(uint64_t block, unsigned i, Symbol s){
+        return (block & ~((uint64_t)31 << (5 * i))) | ((uint64_t)s << (5 * i));
+    }
+
+    // Runs the basic machine inside one block until the head leaves it.
+    Outcome simulate(const Key& key) const {
+        Outcome out = {key.block, 0, key.state, EXIT_NONE, 0};
+        int pos = key.side == LEFT ? 0 : k - 1;
+        while (out.steps < INNER_LIMIT){
+            if (out.state == Program::HALT_ID){
+                out.exit = EXIT_HALT;
+                out.offset = pos;
+                return out;
+            }
+            const Program::Transition& t = prog.at(out.state, cellOf(out.block, pos));
+            if (t.next == Program::UNDEFINED_ID){
+                out.exit = EXIT_UNDEFINED;
+                out.offset = pos;
+                return out;
+            }
+            out.block = withCell(out.block, pos, (Symbol)t.write);
+            out.state = t.next;
+            out.steps++;
+            pos += t.move == RIGHT ? 1 : t.move == LEFT ? -1 : 0;
+            if (pos < 0){
+                out.exit = EXIT_LEFT;
+                return out;
+            }
+            if (pos >= (int)k){
+                out.exit = EXIT_RIGHT;
+                return out;
+            }
+        }
+        return out;
+    }
+
+    public:
+
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+
+    MacroMachine(const Program& p, unsigned blockSize) : prog(p), k(blockSize) {
+        if (k == 0 || k > MAX_BLOCK){
+            throw std::invalid_argument("Block size must be between 1 and 12");
+        }
+        grow();
+    }
+
+    size_t cacheSize() const {
+        return entries;
+    }
+
+    RunResult run(Tape& tape, uint32_t& state, uint64_t maxSteps, uint64_t tapeLimit){
+        uint64_t steps = 0;
+        while (true){
+            if (state == Program::HALT_ID){
+                return {steps, HaltReason::Halted};
+            }
+            if (tape.getSize() >= tapeLimit){
+                return {steps, HaltReason::TapeLimit};
+            }
+            if (steps == maxSteps){
+                return {steps, HaltReason::StepLimit};
+            }
+
+            int64_t headPos = tape.getHead();
+            int64_t start = headPos >= 0 ? headPos / k * k : -((-headPos + k - 1) / k) * (int64_t)k;
+            unsigned offset = headPos - start;
+            bool onEdge = offset == 0 || offset == k - 1;
+            // inside the tape's current extent the size check can't change
+            // until the head leaves the block
+            bool inside = start >= tape.getLeftEdge() && start + k - 1 <= tape.getRightEdge();
+
+            if (onEdge && inside){
+                Key key = {0, state, (uint8_t)(offset == 0 ? LEFT : RIGHT)};
+                uint8_t* cells = tape.cellRun(start, k);
+                for (unsigned i = 0; i < k; i++){
+                    key.block |= (uint64_t)(cells ? cells[i] : (uint8_t)tape.readAt(start + i)) << (5 * i);
+                }
+                const Outcome* found = find(key);
+                if (found == nullptr){
+                    misses++;
+                    found = insert(key, simulate(key));
+                }
+                else{
+                    hits++;
+                }
+                const Outcome& out = *found;
+                if (out.exit != EXIT_NONE && out.steps <= maxSteps - steps){
+                    if (out.block != key.block){
+                        for (unsigned i = 0; i < k; i++){
+                            if (cells){
+                                cells[i] = cellOf(out.block, i);
+                            }
+                            else{
+                                tape.writeAt(start + i, cellOf(out.block, i));
+                            }
+                        }
+                    }
+                    int64_t to = out.exit == EXIT_LEFT ? start - 1
+                               : out.exit == EXIT_RIGHT ? start + k
+                               : start + out.offset;
+                    tape.moveTo(to);
+                    state = out.state;
+                    steps += out.steps;
+                    if (out.exit == EXIT_UNDEFINED){
+                        return {steps, HaltReason::Undefined};
+                    }
+                    continue;
+                }
+            }
+
+            // off a block edge, at the tape's ends or short of budget: one basic step
+            RunResult basic = execute(prog, tape, state, 1, tapeLimit, false);
+            steps += basic.steps;
+            if (basic.steps == 0){
+                return {steps, basic.reason};
+            }
+        }
+    }
+};
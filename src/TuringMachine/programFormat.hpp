@@ -0,0 +1,176 @@
+#pragma once
+
+#include "turingMachine.hpp"
+
+// Compact binary form of a Program, for storing and exchanging large
+// generated machines. Standard descriptions write state numbers in unary,
+// so they grow with the square of the state count; here every number is
+// an unsigned LEB128 varint and a transition takes four or five bytes.
+//
+//   magic           "TMPROG1\0"
+//   flags           bit 0: state names follow (otherwise sdStateName(i))
+//   stateCount
+//   start           stateCount for HALT
+//   names           stateCount of (length, bytes), if flagged
+//   transitions     count, then for each defined slot in table order:
+//                     state - previous state
+//                     read symbol, one byte
+//                     write symbol | move << 5, one byte
+//                     next state, stateCount for HALT
+//
+// Unnamed states take no bytes, so stateCount alone can't be checked
+// against the data; it is capped at MAX_ENCODED_STATES instead.
+const char PROGRAM_MAGIC[8] = {'T', 'M', 'P', 'R', 'O', 'G', '1', '\0'};
+const uint32_t MAX_ENCODED_STATES = 1 << 20;
+
+inline void putVarint(string& out, uint64_t value){
+    while (value >= 0x80){
+        out += (char)(value | 0x80);
+        value >>= 7;
+    }
+    out += (char)value;
+}
+
+// Throws std::invalid_argument if prog has more than MAX_ENCODED_STATES
+// states.
+inline string encodeProgram(const Program& prog){
+    uint32_t n = prog.stateCount();
+    if (n > MAX_ENCODED_STATES){
+        throw std::invalid_argument("Program has more than " + std::to_string(MAX_ENCODED_STATES) + " states");
+    }
+    bool named = false;
+    for (uint32_t state = 0; state < n && !named; state++){
+        named = prog.stateNames[state] != sdStateName(state);
+    }
+
+    string out(PROGRAM_MAGIC, sizeof(PROGRAM_MAGIC));
+    putVarint(out, named ? 1 : 0);
+    putVarint(out, n);
+    putVarint(out, prog.start == Program::HALT_ID ? n : prog.start);
+    if (named){
+        for (const string& name : prog.stateNames){
+            putVarint(out, name.size());
+            out += name;
+        }
+    }
+
+    uint64_t count = 0;
+    for (const Program::Transition& t : prog.table){
+        count += t.next != Program::UNDEFINED_ID;
+    }
+    putVarint(out, count);
+    uint32_t previous = 0;
+    for (uint32_t state = 0; state < n; state++){
+        for (unsigned sym = 0; sym < Program::NUM_SYMBOLS; sym++){
+            const Program::Transition& t = prog.at(state, (Symbol)sym);
+            if (t.next == Program::UNDEFINED_ID){continue;}
+            putVarint(out, state - previous);
+            out += (char)sym;
+            out += (char)(t.write | t.move << 5);
+            putVarint(out, t.next == Program::HALT_ID ? n : t.next);
+            previous = state;
+        }
+    }
+    return out;
+}
+
+inline bool isEncodedProgram(std::string_view data){
+    return data.size() >= sizeof(PROGRAM_MAGIC) && memcmp(data.data(), PROGRAM_MAGIC, sizeof(PROGRAM_MAGIC)) == 0;
+}
+
+// Inverse of encodeProgram. Throws std::invalid_argument on anything it
+// didn't write.
+inline Program decodeProgram(std::string_view data){
+    if (!isEncodedProgram(data)){
+        throw std::invalid_argument("Not an encoded program");
+    }
+    size_t i = sizeof(PROGRAM_MAGIC);
+    auto varint = [&](uint64_t limit){
+        uint64_t value = 0;
+        for (unsigned shift = 0; ; shift += 7){
+            if (i >= data.size() || shift > 63){
+                throw std::invalid_argument("Truncated encoded program");
+            }
+            uint8_t byte = data[i++];
+            value |= (uint64_t)(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0){break;}
+        }
+        if (value > limit){
+            throw std::invalid_argument("Encoded program is out of range at byte " + std::to_string(i));
+        }
+        return value;
+    };
+    auto byte = [&](){
+        if (i >= data.size()){
+            throw std::invalid_argument("Truncated encoded program");
+        }
+        return (uint8_t)data[i++];
+    };
+
+    Program prog;
+    bool named = varint(1) & 1;
+    uint32_t n = varint(MAX_ENCODED_STATES);
+    uint32_t start = varint(n);
+    prog.start = start == n ? Program::HALT_ID : start;
+    // names are at least a byte each, which bounds n by the data
+    if (named && n > data.size() - i){
+        throw std::invalid_argument("Truncated encoded program");
+    }
+    prog.stateNames.resize(n);
+    for (uint32_t state = 0; state < n; state++){
+        if (named){
+            uint64_t length = varint(data.size() - i);
+            prog.stateNames[state] = string(data.substr(i, length));
+            i += length;
+        }
+        else{
+            prog.stateNames[state] = sdStateName(state);
+        }
+    }
+
+    prog.table.assign((size_t)n * Program::NUM_SYMBOLS, Program::Transition());
+    for (size_t slot = 0; slot < prog.table.size(); slot++){
+        prog.table[slot] = {Program::UNDEFINED_ID, (uint8_t)(slot % Program::NUM_SYMBOLS), NONE, 0};
+    }
+    uint64_t count = varint(prog.table.size());
+    uint64_t state = 0;
+    for (uint64_t k = 0; k < count; k++){
+        state += varint(n);
+        uint8_t read = byte();
+        uint8_t packed = byte();
+        uint8_t write = packed & 0x1F;
+        uint8_t move = packed >> 5;
+        uint32_t next = varint(n);
+        if (state >= n || read >= Program::NUM_SYMBOLS || write >= Program::NUM_SYMBOLS || move > NONE){
+            throw std::invalid_argument("Encoded program is out of range at byte " + std::to_string(i));
+        }
+        prog.table[state * Program::NUM_SYMBOLS + read] = {next == n ? Program::HALT_ID : next, write, move, 0};
+    }
+    prog.findSweeps();
+    return prog;
+}
+
+// Loads the machine in path, written in any of the formats turing_headless
+// reads: the binary format above, a standard description, a description
+// number or .javaturing text. Throws std::runtime_error if the file can't
+// be read and std::invalid_argument (a ParseError for .javaturing) if it
+// doesn't parse.
+inline TM* loadMachine(const string& path, Tape& tape, uint64_t szLmt){
+    MappedFile file(path);
+    std::string_view content = file.view();
+    if (isEncodedProgram(content)){
+        return TM::fromProgram(decodeProgram(content), tape, szLmt);
+    }
+
+    std::string_view text = content;
+    const char* space = " \t\r\n\v\f";
+    text.remove_prefix(std::min(text.size(), text.find_first_not_of(space)));
+    text.remove_suffix(text.size() - (text.find_last_not_of(space) + 1));
+    if (!text.empty() && text.find_first_not_of("DCARLN") == std::string_view::npos){
+        return TM::fromSD(text, tape, szLmt);
+    }
+    if (!text.empty() && text.find_first_not_of("123456") == std::string_view::npos){
+        return TM::fromDN(text, tape, szLmt);
+    }
+    return TM::fromStandardDescription(content, tape, szLmt);
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+// A space-time diagram: a tape's history as an image, a row per sample of
+// cells [first, first + width), each cell scale by scale pixels. Rows are
+// colored through a palette, indexed by whatever codes the caller keeps
+// per cell (Symbols, stains), a plain table lookup per cell. The last
+// history rows of pixels are kept in a ring, so a window can show the
+// diagram scrolling however long the run.
+class SpaceTimeDiagram{
+
+    public:
+
+    typedef std::array<uint8_t, 3> Color;
+
+    SpaceTimeDiagram(int64_t first, unsigned width, unsigned history, unsigned scale = 1)
+        : first(first), width(width), scale(std::max(scale, 1u)), history(std::max(history, this->scale)),
+          pixels((size_t)width * this->scale * 3 * this->history) {}
+
+    int64_t getFirst() const {return first;}
+
+    // in cells
+    unsigned getWidth() const {return width;}
+
+    unsigned getScale() const {return scale;}
+
+    // rows of pixels held, at most history
+    unsigned getRows() const {return rows;}
+
+    // codes past the end of palette are drawn black
+    void setPalette(const std::vector<Color>& colors){
+        palette = colors;
+    }
+
+    // Appends a row colored from codes, one per cell: scale rows of pixels,
+    // the first of which it returns.
+    template <typename Code>
+    const uint8_t* addRow(const Code* codes){
+        size_t rowBytes = (size_t)width * scale * 3;
+        uint8_t* row = &pixels[next * rowBytes];
+        uint8_t* p = row;
+        for (unsigned x = 0; x < width; x++){
+            static const Color black = {0, 0, 0};
+            const Color& c = codes[x] < palette.size() ? palette[codes[x]] : black;
+            for (unsigned k = 0; k < scale; k++){
+                *p++ = c[0];
+                *p++ = c[1];
+                *p++ = c[2];
+            }
+        }
+        next = (next + 1) % history;
+        for (unsigned k = 1; k < scale; k++){
+            memcpy(&pixels[next * rowBytes], row, rowBytes);
+            next = (next + 1) % history;
+        }
+        rows = std::min(rows + scale, history);
+        return row;
+    }
+
+    // the rows of pixels held, oldest first, into out
+    void copyRows(std::vector<uint8_t>& out) const {
+        size_t rowBytes = (size_t)width * scale * 3;
+        out.resize(rows * rowBytes);
+        unsigned oldest = rows < history ? 0 : next;
+        size_t tail = (size_t)std::min(rows, history - oldest) * rowBytes;
+        memcpy(out.data(), &pixels[oldest * rowBytes], tail);
+        memcpy(out.data() + tail, pixels.data(), out.size() - tail);
+    }
+
+    private:
+
+    int64_t first;
+    unsigned width;
+    unsigned scale;
+    unsigned history;
+    std::vector<Color> palette;
+    std::vector<uint8_t> pixels;     // history rows of width * scale r, g, b
+    unsigned next = 0;          // the row the next addRow() fills
+    unsigned rows = 0;
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <array>
+#include <cstddef>
+
+// Fixed-size single-producer/single-consumer ring. The producer claims the
+// next free slot, fills it and publishes it; the consumer reads the oldest
+// published slot and pops it. Neither side locks or waits: claim() and
+// front() return nullptr when the ring is full or empty. Slots are reused
+// in place, so elements owning buffers keep their capacity lap to lap.
+template <typename T, size_t N>
+class SpscRing{
+
+    static_assert(N > 0 && (N & (N - 1)) == 0, "SpscRing size must be a power of two");
+
+    private:
+
+    std::array<T, N> slots;
+    alignas(64) std::atomic<size_t> head{0};    // next slot to read, moved by the consumer
+    alignas(64) std::atomic<size_t> tail{0};    // next slot to write, moved by the producer
+
+    public:
+
+    // producer: the slot to fill next, or nullptr if the ring is full
+    T* claim(){
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == N){
+            return nullptr;
+        }
+        return &slots[t & (N - 1)];
+    }
+
+    // producer: hands the claimed slot to the consumer
+    void publish(){
+        tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // consumer: the oldest published slot, or nullptr if there is none
+    T* front(){
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)){
+            return nullptr;
+        }
+        return &slots[h & (N - 1)];
+    }
+
+    // consumer: gives the front slot back to the producer
+    void pop(){
+        head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+};
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <array>
+#include <algorithm>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Sums of K per-cell values along a tape that grows both ways: a segment
+// tree whose leaves are buckets of BUCKET cells, so a tape of 10^7 cells
+// takes a few hundred thousand nodes. Cells never added to are zero, which
+// lets callers store each cell's difference from a blank one and pay
+// nothing for the blank expanse. add() and sum() are O(log n); growing
+// past either end rebuilds the tree, amortized O(1) per bucket.
+template <size_t K>
+class TapeSums{
+
+    public:
+
+    typedef std::array<int64_t, K> Sums;
+
+    static const int64_t BUCKET = 64;
+
+    // the bucket cell i is in, rounding towards minus infinity
+    static int64_t bucketOf(int64_t i){
+        return i >= 0 ? i / BUCKET : -((-i + BUCKET - 1) / BUCKET);
+    }
+
+    void clear(){
+        nodes.clear();
+        base = 0;
+        leaves = 0;
+    }
+
+    void add(int64_t cell, const Sums& delta){
+        int64_t bucket = bucketOf(cell);
+        if (leaves == 0 || bucket < base || bucket >= base + (int64_t)leaves){
+            grow(bucket);
+        }
+        for (size_t n = leaves + (bucket - base); n > 0; n /= 2){
+            for (size_t k = 0; k < K; k++){
+                nodes[n][k] += delta[k];
+            }
+        }
+    }
+
+    // the sums over buckets [from, to)
+    Sums sum(int64_t from, int64_t to) const {
+        Sums total{};
+        from = std::max(from, base);
+        to = std::min(to, base + (int64_t)leaves);
+        if (from >= to){
+            return total;
+        }
+        // bottom-up: whole nodes from both ends towards the root
+        for (size_t l = leaves + (from - base), r = leaves + (to - base); l < r; l /= 2, r /= 2){
+            if (l & 1){
+                accumulate(total, nodes[l++]);
+            }
+            if (r & 1){
+                accumulate(total, nodes[--r]);
+            }
+        }
+        return total;
+    }
+
+    private:
+
+    // nodes[1] is the root, nodes[leaves + j] bucket base + j
+    std::vector<Sums> nodes;
+    int64_t base = 0;
+    size_t leaves = 0;
+
+    static void accumulate(Sums& total, const Sums& s){
+        for (size_t k = 0; k < K; k++){
+            total[k] += s[k];
+        }
+    }
+
+    // makes room for bucket, doubling towards it
+    void grow(int64_t bucket){
+        if (leaves == 0){
+            base = bucket;
+            leaves = 1;
+            nodes.assign(2, Sums{});
+            return;
+        }
+        int64_t newBase = base;
+        size_t newLeaves = leaves;
+        while (bucket < newBase || bucket >= newBase + (int64_t)newLeaves){
+            if (bucket < newBase){
+                newBase -= newLeaves;
+            }
+            newLeaves *= 2;
+        }
+        std::vector<Sums> grown(2 * newLeaves, Sums{});
+        for (size_t j = 0; j < leaves; j++){
+            grown[newLeaves + (base - newBase) + j] = nodes[leaves + j];
+        }
+        for (size_t n = newLeaves - 1; n > 0; n--){
+            grown[n] = grown[2 * n];
+            accumulate(grown[n], grown[2 * n + 1]);
+        }
+        nodes.swap(grown);
+        base = newBase;
+        leaves = newLeaves;
+    }
+};
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+// Work-stealing thread pool. Every worker owns a deque: it pushes and pops
+// its own work at the back, and when that runs dry it steals from the front
+// of the others'. Tasks may submit more tasks (they land on the submitting
+// worker's deque); wait() returns once every submitted task has finished.
+class ThreadPool{
+
+    private:
+
+    struct Queue{
+        std::mutex lock;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<size_t> pending{0};
+    std::atomic<bool> stopping{false};
+    std::atomic<unsigned> nextQueue{0};
+    std::mutex idleLock;
+    std::condition_variable workAvailable;  // idle workers wait here
+    std::condition_variable allDone;        // wait() waits here
+    uint64_t generation = 0;                // submit() count, under idleLock
+
+    // which pool and worker the calling thread is, if any
+    inline static thread_local ThreadPool* currentPool = nullptr;
+    inline static thread_local unsigned currentWorker = 0;
+
+    bool popOwn(unsigned worker, std::function<void()>& task){
+        Queue& q = *queues[worker];
+        std::lock_guard<std::mutex> guard(q.lock);
+        if (q.tasks.empty()){return false;}
+        task = std::move(q.tasks.back());
+        q.tasks.pop_back();
+        return true;
+    }
+
+    bool steal(unsigned worker, std::function<void()>& task){
+        for (unsigned i = 1; i < queues.size(); i++){
+            Queue& q = *queues[(worker + i) % queues.size()];
+            std::lock_guard<std::mutex> guard(q.lock);
+            if (!q.tasks.empty()){
+                task = std::move(q.tasks.front());
+                q.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void work(unsigned worker){
+        currentPool = this;
+        currentWorker = worker;
+        std::function<void()> task;
+        while (true){
+            // a task submitted after this read bumps generation, so the
+            // wait below can't miss one the search didn't find
+            uint64_t seen;
+            {
+                std::lock_guard<std::mutex> guard(idleLock);
+                seen = generation;
+            }
+            if (popOwn(worker, task) || steal(worker, task)){
+                task();
+                task = nullptr;
+                if (--pending == 0){
+                    std::lock_guard<std::mutex> guard(idleLock);
+                    allDone.notify_all();
+                }
+                continue;
+            }
+            std::unique_lock<std::mutex> guard(idleLock);
+            workAvailable.wait(guard, [&]{ return stopping || generation != seen; });
+            if (stopping){
+                return;
+            }
+        }
+    }
+
+    public:
+
+    explicit ThreadPool(unsigned threads = std::thread::hardware_concurrency()){
+        threads = std::max(threads, 1u);
+        for (unsigned i = 0; i < threads; i++){
+            queues.push_back(std::make_unique<Queue>());
+        }
+        for (unsigned i = 0; i < threads; i++){
+            workers.emplace_back(&ThreadPool::work, this, i);
+        }
+    }
+
+    ~ThreadPool(){
+        wait();
+        {
+            std::lock_guard<std::mutex> guard(idleLock);
+            stopping = true;
+            workAvailable.notify_all();
+        }
+        for (std::thread& worker : workers){
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned size() const {
+        return workers.size();
+    }
+
+    void submit(std::function<void()> task){
+        unsigned target = currentPool == this ? currentWorker : nextQueue++ % queues.size();
+        pending++;
+        {
+            std::lock_guard<std::mutex> guard(queues[target]->lock);
+            queues[target]->tasks.push_back(std::move(task));
+        }
+        std::lock_guard<std::mutex> guard(idleLock);
+        generation++;
+        workAvailable.notify_one();
+    }
+
+    void wait(){
+        std::unique_lock<std::mutex> guard(idleLock);
+        allDone.wait(guard, [this]{ return pending == 0; });
+    }
+};
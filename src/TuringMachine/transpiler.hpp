@@ -0,0 +1,232 @@
+#pragma once
+
+#include "turingMachine.hpp"
+
+// Ahead-of-time translation of a compiled Program into standalone C++.
+// Every state becomes a label with a switch on the scanned symbol, and
+// every transition a straight-line write / move / goto, so the generated
+// run() does no table lookups. It keeps the same tape (54 blank cells from
+// cell 0, growing either way), the same step count and the same stopping
+// rules as execute(), and prints the same JSON report as turing_headless.
+//
+// The file builds on its own into an executable; compile it with
+// -DTM_NO_MAIN to link run() into something else. Everything it defines
+// lives in namespace ns.
+class Transpiler{
+
+    private:
+
+    const Program& prog;
+    string ns;
+    string source;
+    stringstream out;
+
+    static string quoted(const string& s){
+        stringstream ss;
+        ss << '"';
+        for (char c : s){
+            if (c == '"' || c == '\\'){
+                ss << '\\' << c;
+            }
+            else if ((unsigned char)c < 0x20){
+                ss << ' ';
+            }
+            else{
+                ss << c;
+            }
+        }
+        ss << '"';
+        return ss.str();
+    }
+
+    static string label(uint32_t state){
+        return "state_" + std::to_string(state);
+    }
+
+    void emitHeader(){
+        out << "// Generated from " << source << " by turing_headless --emit-cpp; do not edit.\n"
+            << "#include <cstdint>\n"
+            << "#include <cstdio>\n"
+            << "#include <cstdlib>\n"
+            << "#include <cstring>\n"
+            << "#include <chrono>\n"
+            << "#include <vector>\n"
+            << "\n"
+            << "namespace " << ns << "{\n"
+            << "\n"
+            << "const char* const machine = " << quoted(source) << ";\n"
+            << "const unsigned stateCount = " << prog.stateCount() << ";\n"
+            << "const char* const stateNames[] = {";
+        for (uint32_t s = 0; s < prog.stateCount(); s++){
+            out << (s ? ", " : "") << quoted(prog.stateNames[s]);
+        }
+        out << "};\n"
+            << "const char symbolChars[] = " << quoted(string(symToChar, Program::NUM_SYMBOLS)) << ";\n"
+            << "const int64_t HALT = -1;\n"
+            << "const int64_t start = " << (prog.start == Program::HALT_ID ? string("HALT") : std::to_string(prog.start)) << ";\n"
+            << "\n"
+            << "enum Reason{HALTED, UNDEFINED, STEP_LIMIT, TAPE_LIMIT};\n"
+            << "const char* const reasonNames[] = {\"halted\", \"undefined-transition\", \"step-limit\", \"tape-limit\"};\n"
+            << "\n"
+            << "// Cell i (head starts on 0) is cells[origin + i]; left and right are the\n"
+            << "// extent the tape has reached, as in Tape.\n"
+            << "struct Tape{\n"
+            << "    std::vector<uint8_t> cells;\n"
+            << "    int64_t origin;\n"
+            << "    int64_t head;\n"
+            << "    int64_t left;\n"
+            << "    int64_t right;\n"
+            << "\n"
+            << "    explicit Tape(unsigned size = 54) : cells(4 * size + 64, 0), origin(2 * size + 32), head(0), left(0), right((int64_t)size - 1) {}\n"
+            << "\n"
+            << "    uint64_t size() const {return right - left + 1;}\n"
+            << "    uint8_t at(int64_t i) const {return cells[origin + i];}\n"
+            << "};\n"
+            << "\n"
+            << "struct Result{\n"
+            << "    uint64_t steps;\n"
+            << "    Reason reason;\n"
+            << "    int64_t state;      // HALT or an index into stateNames\n"
+            << "};\n"
+            << "\n";
+    }
+
+    // head moves by one; the first time it passes an edge the tape grows,
+    // and a run that isn't halting stops once the tape is tapeLimit wide
+    void emitMove(uint8_t move, const string& next, bool halting, const string& indent){
+        if (move == RIGHT){
+            out << indent << "if (++h > hi){\n"
+                << indent << "    if (h == cap){tape.cells.resize(2 * cap, 0); c = tape.cells.data(); cap *= 2;}\n"
+                << indent << "    hi = h;\n";
+        }
+        else if (move == LEFT){
+            out << indent << "if (--h < lo){\n"
+                << indent << "    if (h < 0){tape.cells.insert(tape.cells.begin(), cap, 0); c = tape.cells.data(); h += cap; lo += cap; hi += cap; tape.origin += cap; cap *= 2;}\n"
+                << indent << "    lo = h;\n";
+        }
+        else{
+            return;
+        }
+        if (!halting){
+            out << indent << "    if (hi - lo + 1 >= limit){state = " << next << "; reason = TAPE_LIMIT; goto done;}\n";
+        }
+        out << indent << "}\n";
+    }
+
+    void emitState(uint32_t state){
+        out << "\n" << label(state) << ": // " << prog.stateNames[state] << "\n"
+            << "    if (steps == maxSteps){state = " << state << "; reason = STEP_LIMIT; goto done;}\n"
+            << "    switch (c[h]){\n";
+        for (unsigned sym = 0; sym < Program::NUM_SYMBOLS; sym++){
+            const Program::Transition& t = prog.at(state, (Symbol)sym);
+            if (t.next == Program::UNDEFINED_ID){continue;}
+            bool halting = t.next == Program::HALT_ID;
+            string next = halting ? "HALT" : std::to_string(t.next);
+            out << "        case " << sym << ": // " << symToName[sym] << " -> " << symToName[t.write] << " "
+                << (t.move == RIGHT ? "R" : t.move == LEFT ? "L" : "N") << " " << prog.nameOf(t.next) << "\n";
+            if (t.write != sym){
+                out << "            c[h] = " << (unsigned)t.write << ";\n";
+            }
+            out << "            steps++;\n";
+            emitMove(t.move, next, halting, "            ");
+            if (halting){
+                out << "            state = HALT; reason = HALTED; goto done;\n";
+            }
+            else{
+                out << "            goto " << label(t.next) << ";\n";
+            }
+        }
+        out << "        default:\n"
+            << "            state = " << state << "; reason = UNDEFINED; goto done;\n"
+            << "    }\n";
+    }
+
+    void emitRun(){
+        out << "// Same contract as execute(): runs from state until it halts, reaches an\n"
+            << "// undefined transition, has taken maxSteps steps or the tape is tapeLimit\n"
+            << "// cells wide.\n"
+            << "inline Result run(Tape& tape, uint64_t maxSteps, uint64_t tapeLimit, int64_t state = start){\n"
+            << "    uint8_t* c = tape.cells.data();\n"
+            << "    int64_t cap = tape.cells.size();\n"
+            << "    int64_t h = tape.origin + tape.head;\n"
+            << "    int64_t lo = tape.origin + tape.left;\n"
+            << "    int64_t hi = tape.origin + tape.right;\n"
+            << "    int64_t limit = tapeLimit > (uint64_t)INT64_MAX ? INT64_MAX : (int64_t)tapeLimit;\n"
+            << "    uint64_t steps = 0;\n"
+            << "    Reason reason = HALTED;\n"
+            << "\n"
+            << "    if (state == HALT){goto done;}\n"
+            << "    if (hi - lo + 1 >= limit){reason = TAPE_LIMIT; goto done;}\n"
+            << "    switch (state){\n";
+        for (uint32_t s = 0; s < prog.stateCount(); s++){
+            out << "        case " << s << ": goto " << label(s) << ";\n";
+        }
+        out << "        default: reason = UNDEFINED; goto done;\n"
+            << "    }\n";
+        for (uint32_t s = 0; s < prog.stateCount(); s++){
+            emitState(s);
+        }
+        out << "\n"
+            << "done:\n"
+            << "    tape.head = h - tape.origin;\n"
+            << "    tape.left = lo - tape.origin;\n"
+            << "    tape.right = hi - tape.origin;\n"
+            << "    return {steps, reason, state};\n"
+            << "}\n"
+            << "\n"
+            << "} // namespace " << ns << "\n"
+            << "\n";
+    }
+
+    void emitMain(){
+        out << "#ifndef TM_NO_MAIN\n"
+            << "int main(int argc, const char* argv[]){\n"
+            << "    using namespace " << ns << ";\n"
+            << "    uint64_t maxSteps = 100000000;\n"
+            << "    uint64_t tapeLimit = 1000000;\n"
+            << "    bool dumpTape = false;\n"
+            << "    for (int i = 1; i < argc; i++){\n"
+            << "        if (!strcmp(argv[i], \"--steps\") && i + 1 < argc){maxSteps = strtoull(argv[++i], nullptr, 10);}\n"
+            << "        else if (!strcmp(argv[i], \"--tape-limit\") && i + 1 < argc){tapeLimit = strtoull(argv[++i], nullptr, 10);}\n"
+            << "        else if (!strcmp(argv[i], \"--dump-tape\")){dumpTape = true;}\n"
+            << "        else{\n"
+            << "            fprintf(stderr, \"usage: %s [--steps N] [--tape-limit N] [--dump-tape]\\n\", argv[0]);\n"
+            << "            return 2;\n"
+            << "        }\n"
+            << "    }\n"
+            << "\n"
+            << "    Tape tape;\n"
+            << "    auto begin = std::chrono::steady_clock::now();\n"
+            << "    Result result = run(tape, maxSteps, tapeLimit);\n"
+            << "    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();\n"
+            << "\n"
+            << "    printf(\"{\\\"machine\\\":\\\"%s\\\",\\\"steps\\\":%llu,\\\"halt_reason\\\":\\\"%s\\\",\\\"state\\\":\\\"%s\\\"\"\n"
+            << "           \",\\\"tape_size\\\":%llu,\\\"left_edge\\\":%lld,\\\"right_edge\\\":%lld,\\\"head\\\":%lld\"\n"
+            << "           \",\\\"wall_seconds\\\":%g,\\\"steps_per_second\\\":%llu}\\n\",\n"
+            << "           machine, (unsigned long long)result.steps, reasonNames[result.reason],\n"
+            << "           result.state == HALT ? \"HALT\" : stateNames[result.state],\n"
+            << "           (unsigned long long)tape.size(), (long long)tape.left, (long long)tape.right, (long long)tape.head,\n"
+            << "           seconds, (unsigned long long)(seconds > 0 ? result.steps / seconds : 0));\n"
+            << "    if (dumpTape){\n"
+            << "        for (int64_t i = tape.left; i <= tape.right; i++){\n"
+            << "            putchar(symbolChars[tape.at(i)]);\n"
+            << "        }\n"
+            << "        putchar('\\n');\n"
+            << "    }\n"
+            << "    return 0;\n"
+            << "}\n"
+            << "#endif\n";
+    }
+
+    public:
+
+    Transpiler(const Program& p, const string& sourceName, const string& nameSpace = "turing") : prog(p), ns(nameSpace), source(sourceName) {}
+
+    string generate(){
+        out.str("");
+        emitHeader();
+        emitRun();
+        emitMain();
+        return out.str();
+    }
+};
@@ -1,14 +1,42 @@
+#pragma once
+
 #include <unordered_map>
 #include <unordered_set>
 #include <string>
+#include <string_view>
 #include <iostream>
 #include <vector>
 #include <sstream>
 #include <fstream>
 #include <ostream>
 #include <algorithm>
-
-#include "/Users/benmeyers/Desktop/turingViz/src/graphics/graphics.h"
+#include <memory>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define TM_HAVE_MMAP 1
+#else
+#define TM_HAVE_MMAP 0
+#endif
+
+#include "../graphics/graphics.h"
+#include "spscRing.hpp"
+#include "tapeSums.hpp"
+#include "spaceTime.hpp"
 
 using std::string;
 using std::stringstream;
@@ -23,32 +51,67 @@ using std::endl;
 using std::replace;
 using std::cerr;
 
-static vector<string> split(const string& str, char delimiter) {
-    vector<string> tokens;
-    stringstream ss(str);
-    string token;
-    while (getline(ss, token, delimiter)) {
-        tokens.push_back(token);
-    }
-    return tokens;
-}
-
-static void ltrim(string &s) {
-    s.erase(s.begin(), find_if(s.begin(), s.end(), [](unsigned char ch) {
-        return !isspace(ch);
-    }));
-}
-
 static void rtrim(string &s) {
     s.erase(find_if(s.rbegin(), s.rend(), [](unsigned char ch) {
         return !isspace(ch);
     }).base(), s.end());
 }
 
-static void trim(string &s) {
-    ltrim(s);
-    rtrim(s);
-}
+// A whole file, read-only: memory-mapped where the platform allows, read
+// into memory otherwise. Throws std::runtime_error if it can't be opened.
+class MappedFile{
+
+    private:
+
+    const char* bytes = nullptr;
+    size_t length = 0;
+    string contents;    // when not mapped
+
+    public:
+
+    explicit MappedFile(const string& path){
+#if TM_HAVE_MMAP
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0){
+            throw std::runtime_error("Failed to open file: " + path);
+        }
+        off_t size = lseek(fd, 0, SEEK_END);
+        if (size > 0){
+            void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped == MAP_FAILED){
+                close(fd);
+                throw std::runtime_error("Failed to map file: " + path);
+            }
+            bytes = (const char*)mapped;
+            length = size;
+        }
+        close(fd);
+#else
+        std::ifstream in(path, std::ios::binary);
+        if (!in){
+            throw std::runtime_error("Failed to open file: " + path);
+        }
+        contents.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        bytes = contents.data();
+        length = contents.size();
+#endif
+    }
+
+    ~MappedFile(){
+#if TM_HAVE_MMAP
+        if (bytes != nullptr){
+            munmap((void*)bytes, length);
+        }
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    std::string_view view() const {
+        return std::string_view(bytes, length);
+    }
+};
 
 // Helper to convert hex color to RGB components
 struct RGB {
@@ -155,6 +218,11 @@ const unordered_map<Symbol, char> toStr = {
     {V, 'V'},
     {ASTR, '*'}
 };
+// display char of each Symbol, indexed by its enum value (same as toStr)
+const char symToChar[] = {' ', '0', '1', 'R', 'L', 'N', '@', 'X', 'Y', 'Z', '*', 'Q', 'A', 'S', 'T', 'U', 'V'};
+// .javaturing name of each Symbol, indexed the same way (inverse of toSym)
+const char* const symToName[] = {"S_", "S0", "S1", "R", "L", "N", "SENTINEL", "X", "Y", "Z", "*", "Q", "A", "S", "T", "U", "V"};
+
 const unordered_map<string, Symbol> toSym = {
     {"S_", S_},
     {"S0", S0},
@@ -194,6 +262,12 @@ const unordered_map<Symbol, unsigned> symInd = {
     {V, 16}
 
 };
+// inverse of symInd: the Symbol with each SD index
+const Symbol sdSymbols[] = {S_, S0, S1, R, L, N, SENTINEL, X, Y, Z, ASTR, Q, A, S, T, U, V};
+enum Direction{
+    LEFT, RIGHT, NONE
+};
+
 const unordered_map<char, unsigned> sdToNum = {
     {'D', 1},
     {'C', 2},
@@ -203,199 +277,899 @@ const unordered_map<char, unsigned> sdToNum = {
     {'N', 6}
 };
 
+// Length of the run of cells at the start of cells[0..n) whose symbols are
+// all in mask (bit s set for Symbol s).
+inline size_t matchingPrefix(const uint8_t* cells, size_t n, uint32_t mask){
+    // most runs are short, only set up the vector compare for long ones
+    size_t i = 0;
+    for (; i < n && i < 16; i++){
+        if (((mask >> cells[i]) & 1) == 0){return i;}
+    }
+#if defined(__SSE2__)
+    __m128i members[32];
+    int count = 0;
+    for (unsigned s = 0; s < 32; s++){
+        if ((mask >> s) & 1){members[count++] = _mm_set1_epi8((char)s);}
+    }
+    for (; i + 16 <= n; i += 16){
+        __m128i block = _mm_loadu_si128((const __m128i*)(cells + i));
+        __m128i hit = _mm_setzero_si128();
+        for (int m = 0; m < count; m++){
+            hit = _mm_or_si128(hit, _mm_cmpeq_epi8(block, members[m]));
+        }
+        unsigned misses = ~_mm_movemask_epi8(hit) & 0xFFFF;
+        if (misses != 0){
+            return i + __builtin_ctz(misses);
+        }
+    }
+#endif
+    for (; i < n; i++){
+        if (((mask >> cells[i]) & 1) == 0){return i;}
+    }
+    return n;
+}
+
+// Length of the run of cells at the end of cells[0..n) whose symbols are all
+// in mask.
+inline size_t matchingSuffix(const uint8_t* cells, size_t n, uint32_t mask){
+    size_t i = n;
+    for (; i > 0 && n - i < 16; i--){
+        if (((mask >> cells[i - 1]) & 1) == 0){return n - i;}
+    }
+#if defined(__SSE2__)
+    __m128i members[32];
+    int count = 0;
+    for (unsigned s = 0; s < 32; s++){
+        if ((mask >> s) & 1){members[count++] = _mm_set1_epi8((char)s);}
+    }
+    for (; i >= 16; i -= 16){
+        __m128i block = _mm_loadu_si128((const __m128i*)(cells + i - 16));
+        __m128i hit = _mm_setzero_si128();
+        for (int m = 0; m < count; m++){
+            hit = _mm_or_si128(hit, _mm_cmpeq_epi8(block, members[m]));
+        }
+        unsigned misses = ~_mm_movemask_epi8(hit) & 0xFFFF;
+        if (misses != 0){
+            return n - (i - 16 + 31 - __builtin_clz(misses)) - 1;
+        }
+    }
+#endif
+    for (; i > 0; i--){
+        if (((mask >> cells[i - 1]) & 1) == 0){return n - i;}
+    }
+    return n;
+}
+
+// Bidirectional tape made of fixed-size chunks, addressed by signed cell
+// coordinates (the head starts on cell 0). Moving past either end only ever
+// allocates a fresh chunk; existing cells are never copied or shifted, so a
+// cell's coordinate is stable for the life of the tape.
+//
+// After pack(), chunks hold 2, 4 or 5 bits per cell, as codes into the
+// machine's alphabet. The (at most two) chunks the head is working in are
+// kept unpacked in windows, so the step loops still see one Symbol per
+// byte; a chunk is packed back when its window is needed for another.
+//
+// After mapFile(), chunks live in a sparse memory-mapped file instead of
+// the heap: address space for `reserve` cells either side of cell 0 is
+// set aside up front, pages are faulted in as the head reaches them and
+// the OS writes cold ones back. The file is a tape image (see
+// ImageHeader) that stays valid after the run.
 class Tape{
 
+    public:
+
+    static const unsigned CHUNK_BITS = 16;
+    static const int64_t CHUNK_CELLS = int64_t(1) << CHUNK_BITS;
+    static const int64_t CHUNK_MASK = CHUNK_CELLS - 1;
+
+    // First bytes of a tape image. Cell i is the byte at
+    // headerBytes + reserve + i, holding its Symbol code; cells outside
+    // [leftEdge, rightEdge] hold fill (or 0, if never touched).
+    struct ImageHeader{
+        char magic[8];          // "TMTAPE1"
+        uint32_t headerBytes;
+        uint32_t cellBytes;     // 1
+        int64_t reserve;
+        int64_t head;
+        int64_t leftEdge;
+        int64_t rightEdge;
+        uint32_t fill;
+        char symbols[32];       // display char of each Symbol code, as symToChar
+    };
+    static const uint32_t IMAGE_HEADER_BYTES = 4096;
+
+    // the color of the configuration that last wrote a cell, as an index
+    // into the machine's palette of stains (see TM::initializeColors());
+    // UNSTAINED for a cell never stained
+    typedef uint16_t Stain;
+    static constexpr Stain UNSTAINED = 0;
+
     private:
 
-    char* values;
-    unsigned head;
-    unsigned size;
-    string tapeFill;
-    public:
-    unordered_map<unsigned, string> cellColors;
-    unsigned cellsInUse;
+    // one Symbol code per cell; chars only appear when printing.
+    // chunk k >= 0 is rightChunks[k], chunk k < 0 is leftChunks[-k - 1]
+    vector<uint8_t*> rightChunks;
+    vector<uint8_t*> leftChunks;
+    uint8_t* current;       // chunk under the head
+    int64_t head;
+    int64_t leftEdge;       // leftmost and rightmost cells the tape has reached
+    int64_t rightEdge;
+    Symbol fill;
+    // each chunk's stains, a Stain per cell, laid out like the chunks;
+    // nullptr until a cell in it is stained
+    vector<Stain*> rightStains;
+    vector<Stain*> leftStains;
+
+    // packed mode, bits > 0: cell j of a packed chunk is field j % 8 of
+    // group j / 8, each group being `bits` little-endian bytes
+    unsigned bits = 0;
+    uint8_t codeOf[32];         // Symbol -> code
+    uint8_t symbolOf[32];       // code -> Symbol
+    struct Window{
+        int64_t chunk = NO_CHUNK;
+        uint8_t* cells = nullptr;
+        uint64_t used = 0;      // for least-recently-used eviction
+    };
+    static const int64_t NO_CHUNK = INT64_MIN;
+    Window windows[2];
+    uint64_t uses = 0;
+
+    // file-backed mode, image != nullptr: cell i is at cellBase[i]
+    uint8_t* image = nullptr;
+    uint8_t* cellBase = nullptr;
+    size_t imageBytes = 0;
+    int64_t reserveChunks = 0;
+    int imageFd = -1;
+
+    void writeHeader(){
+        ImageHeader header = {};
+        memcpy(header.magic, "TMTAPE1", 8);
+        header.headerBytes = IMAGE_HEADER_BYTES;
+        header.cellBytes = 1;
+        header.reserve = reserveChunks * CHUNK_CELLS;
+        header.head = head;
+        header.leftEdge = leftEdge;
+        header.rightEdge = rightEdge;
+        header.fill = fill;
+        memcpy(header.symbols, symToChar, sizeof(symToChar));
+        memcpy(image, &header, sizeof(header));
+    }
+
+    void closeImage(){
+#if TM_HAVE_MMAP
+        if (image == nullptr){return;}
+        writeHeader();
+        munmap(image, imageBytes);
+        close(imageFd);
+        image = cellBase = nullptr;
+        imageFd = -1;
+        rightChunks.clear();
+        leftChunks.clear();
+#endif
+    }
+
+    size_t chunkBytes() const {
+        // packed chunks get 8 bytes of slack so a group can be read as a uint64_t
+        return bits == 0 ? CHUNK_CELLS : CHUNK_CELLS / 8 * bits + 8;
+    }
 
+    uint8_t codeAt(const uint8_t* packed, int64_t j) const {
+        uint64_t group;
+        memcpy(&group, packed + j / 8 * bits, sizeof(group));
+        return (group >> (j % 8 * bits)) & ((1u << bits) - 1);
+    }
 
-    unsigned getHead(){return head;}
+    void setCode(uint8_t* packed, int64_t j, uint8_t code){
+        uint64_t group;
+        memcpy(&group, packed + j / 8 * bits, sizeof(group));
+        unsigned shift = j % 8 * bits;
+        group = (group & ~((uint64_t)((1u << bits) - 1) << shift)) | ((uint64_t)code << shift);
+        memcpy(packed + j / 8 * bits, &group, bits);
+    }
 
-    Tape(unsigned sz, const string tf) : head(0), size(sz), values(new char[sz]), tapeFill(tf) {
-        for (unsigned i = 0; i < size; i++) {
-            values[i] = toStr.at(S_);
-            cellColors[i] = graphics::WHITE;
+    void packChunk(const uint8_t* cells, uint8_t* packed) const {
+        for (int64_t g = 0; g < CHUNK_CELLS / 8; g++){
+            uint64_t group = 0;
+            for (unsigned j = 0; j < 8; j++){
+                group |= (uint64_t)codeOf[cells[g * 8 + j]] << (j * bits);
+            }
+            memcpy(packed + g * bits, &group, bits);
         }
     }
-    
-    Tape(const string tf) : head(0), size(54), values(new char[54]), tapeFill(tf) {
-        for (unsigned i = 0; i < size; i++) {
-            values[i] = toStr.at(S_);
-            cellColors[i] = graphics::WHITE;
+
+    void unpackChunk(const uint8_t* packed, uint8_t* cells) const {
+        uint64_t mask = (1u << bits) - 1;
+        for (int64_t g = 0; g < CHUNK_CELLS / 8; g++){
+            uint64_t group;
+            memcpy(&group, packed + g * bits, sizeof(group));
+            for (unsigned j = 0; j < 8; j++){
+                cells[g * 8 + j] = symbolOf[(group >> (j * bits)) & mask];
+            }
+        }
+    }
+
+    // a fresh chunk: every cell holds fill
+    uint8_t* blankChunk() const {
+        uint8_t* cells = new uint8_t[chunkBytes()];
+        if (bits == 0){
+            std::fill(cells, cells + CHUNK_CELLS, (uint8_t)fill);
+        }
+        else{
+            uint64_t group = 0;
+            for (unsigned j = 0; j < 8; j++){
+                group |= (uint64_t)codeOf[fill] << (j * bits);
+            }
+            for (int64_t g = 0; g < CHUNK_CELLS / 8; g++){
+                memcpy(cells + g * bits, &group, bits);
+            }
+            std::fill(cells + CHUNK_CELLS / 8 * bits, cells + chunkBytes(), 0);
         }
+        return cells;
     }
 
-    Tape(unsigned sz) : head(0), size(sz), values(new char[54]), tapeFill("S_") {
-        for (unsigned i = 0; i < size; i++) {
-            values[i] = toStr.at(S_);
-            cellColors[i] = graphics::WHITE;
+    const Window* windowOf(int64_t chunk) const {
+        for (const Window& w : windows){
+            if (w.chunk == chunk){return &w;}
         }
+        return nullptr;
     }
-    
-    Tape() : head(0), size(54), values(new char[54]), tapeFill("S_") {
-        for (unsigned i = 0; i < size; i++) {
-            values[i] = toStr.at(S_);
-            cellColors[i] = graphics::WHITE;
+
+    // Unpacked cells of chunk in packed mode, paging it into the least
+    // recently used window (and packing that window's chunk back first).
+    uint8_t* windowFor(int64_t chunk){
+        Window* w = &windows[0];
+        for (Window& candidate : windows){
+            if (candidate.chunk == chunk){
+                candidate.used = ++uses;
+                return candidate.cells;
+            }
+            if (candidate.used < w->used){
+                w = &candidate;
+            }
+        }
+        if (w->chunk != NO_CHUNK){
+            packChunk(w->cells, chunkSlot(w->chunk));
+        }
+        uint8_t*& packed = chunkSlot(chunk);
+        if (packed == nullptr){
+            // brand new: nothing to unpack, it is packed when evicted
+            packed = new uint8_t[chunkBytes()];
+            std::fill(packed + CHUNK_CELLS / 8 * bits, packed + chunkBytes(), 0);
+            std::fill(w->cells, w->cells + CHUNK_CELLS, (uint8_t)fill);
+        }
+        else{
+            unpackChunk(packed, w->cells);
+        }
+        w->chunk = chunk;
+        w->used = ++uses;
+        return w->cells;
+    }
+
+    // packs both windows back into their chunks and empties them
+    void flushWindows(){
+        for (Window& w : windows){
+            if (w.chunk != NO_CHUNK){
+                packChunk(w.cells, chunkSlot(w.chunk));
+                w.chunk = NO_CHUNK;
+            }
+        }
+    }
+
+    uint8_t*& chunkSlot(int64_t chunk){
+        vector<uint8_t*>& side = chunk >= 0 ? rightChunks : leftChunks;
+        size_t i = chunk >= 0 ? chunk : -chunk - 1;
+        if (i >= side.size()){
+            side.resize(i + 1, nullptr);
+        }
+        return side[i];
+    }
+
+    const uint8_t* findChunk(int64_t chunk) const {
+        const vector<uint8_t*>& side = chunk >= 0 ? rightChunks : leftChunks;
+        size_t i = chunk >= 0 ? chunk : -chunk - 1;
+        return i < side.size() ? side[i] : nullptr;
+    }
+
+    Stain*& stainSlot(int64_t chunk){
+        vector<Stain*>& side = chunk >= 0 ? rightStains : leftStains;
+        size_t i = chunk >= 0 ? chunk : -chunk - 1;
+        if (i >= side.size()){
+            side.resize(i + 1, nullptr);
+        }
+        return side[i];
+    }
+
+    const Stain* findStains(int64_t chunk) const {
+        const vector<Stain*>& side = chunk >= 0 ? rightStains : leftStains;
+        size_t i = chunk >= 0 ? chunk : -chunk - 1;
+        return i < side.size() ? side[i] : nullptr;
+    }
+
+    void copyStains(const Tape& other){
+        for (int side = 0; side < 2; side++){
+            const vector<Stain*>& from = side == 0 ? other.rightStains : other.leftStains;
+            vector<Stain*>& to = side == 0 ? rightStains : leftStains;
+            to.assign(from.size(), nullptr);
+            for (size_t i = 0; i < from.size(); i++){
+                if (from[i] != nullptr){
+                    to[i] = new Stain[CHUNK_CELLS];
+                    std::copy(from[i], from[i] + CHUNK_CELLS, to[i]);
+                }
+            }
         }
+        cellsInUse = other.cellsInUse;
+    }
+
+    void freeStains(){
+        for (Stain* stains : rightStains){delete[] stains;}
+        for (Stain* stains : leftStains){delete[] stains;}
+        rightStains.clear();
+        leftStains.clear();
+        cellsInUse = 0;
     }
+
+    // one Symbol per byte for chunk, whatever the mode
+    uint8_t* chunkAt(int64_t chunk){
+        if (bits != 0){
+            return windowFor(chunk);
+        }
+        uint8_t*& cells = chunkSlot(chunk);
+        if (cells == nullptr){
+            if (image != nullptr){
+                if (chunk < -reserveChunks || chunk >= reserveChunks){
+                    throw std::length_error("Tape ran past the cells reserved in its file");
+                }
+                cells = cellBase + chunk * CHUNK_CELLS;
+                // untouched pages read as S_ (0) already
+                if (fill != S_){
+                    std::fill(cells, cells + CHUNK_CELLS, (uint8_t)fill);
+                }
+            }
+            else{
+                cells = blankChunk();
+            }
+        }
+        return cells;
+    }
+
+    void copyChunks(const Tape& other){
+        bits = other.bits;
+        std::copy(other.codeOf, other.codeOf + 32, codeOf);
+        std::copy(other.symbolOf, other.symbolOf + 32, symbolOf);
+        for (int side = 0; side < 2; side++){
+            const vector<uint8_t*>& from = side == 0 ? other.rightChunks : other.leftChunks;
+            vector<uint8_t*>& to = side == 0 ? rightChunks : leftChunks;
+            to.assign(from.size(), nullptr);
+            for (size_t i = 0; i < from.size(); i++){
+                if (from[i] != nullptr){
+                    to[i] = new uint8_t[chunkBytes()];
+                    std::copy(from[i], from[i] + chunkBytes(), to[i]);
+                }
+            }
+        }
+        for (int i = 0; i < 2; i++){
+            windows[i] = Window();
+            if (bits != 0){
+                windows[i].cells = new uint8_t[CHUNK_CELLS];
+                if (other.windows[i].chunk != NO_CHUNK){
+                    windows[i] = {other.windows[i].chunk, windows[i].cells, other.windows[i].used};
+                    std::copy(other.windows[i].cells, other.windows[i].cells + CHUNK_CELLS, windows[i].cells);
+                }
+            }
+        }
+        uses = other.uses;
+        current = chunkAt(head >> CHUNK_BITS);
+    }
+
+    void freeChunks(){
+        closeImage();
+        for (uint8_t* cells : rightChunks){delete[] cells;}
+        for (uint8_t* cells : leftChunks){delete[] cells;}
+        rightChunks.clear();
+        leftChunks.clear();
+        for (Window& w : windows){
+            delete[] w.cells;
+            w = Window();
+        }
+    }
+
+    public:
+
+    // cells stained at least once, counted off the stains as they're set
+    unsigned cellsInUse;
+
+    Tape(unsigned sz, const string tf) : head(0), leftEdge(0), rightEdge((int64_t)sz - 1), fill(toSym.at(tf)), cellsInUse(0) {
+        current = chunkAt(0);
+        if (fill != S_){
+            for (int64_t i = 0; i < (int64_t)sz; i++){
+                chunkAt(i >> CHUNK_BITS)[i & CHUNK_MASK] = S_;
+            }
+        }
+    }
+
+    Tape(const string tf) : Tape(54, tf) {}
+
+    Tape(unsigned sz) : Tape(sz, "S_") {}
+
+    Tape() : Tape(54, "S_") {}
     
     ~Tape() {
-        delete[] values;
+        freeChunks();
+        freeStains();
     }
     
-    Tape(const Tape& other) : head(other.head), size(other.size), tapeFill(other.tapeFill) {
-        values = new char[size]; 
-        for (unsigned i = 0; i < size; i++) {
-            values[i] = other.values[i]; 
-            cellColors[i] = graphics::WHITE;
-        }
+    Tape(const Tape& other) : head(other.head), leftEdge(other.leftEdge), rightEdge(other.rightEdge), fill(other.fill), cellsInUse(0) {
+        copyChunks(other);
+        copyStains(other);
     }
     
     Tape& operator=(const Tape& other) {
         if (this != &other) { 
-            delete[] values; 
+            freeChunks();
+            freeStains();
             
             head = other.head;
-            size = other.size;
-            tapeFill = other.tapeFill;
+            leftEdge = other.leftEdge;
+            rightEdge = other.rightEdge;
+            fill = other.fill;
             
-            values = new char[size]; 
-            for (unsigned i = 0; i < size; i++) {
-                values[i] = other.values[i]; 
-            }
+            copyChunks(other);
+            copyStains(other);
         }
         return *this;
     }
 
-    Symbol read(){
-        char vl = values[head];
-        for (const auto& pair : toStr){
-            if (pair.second == vl){return pair.first;}
+    // Back to a fresh sz-cell tape with the head on cell 0. Chunks already
+    // allocated are kept and only the cells the tape reached are cleared,
+    // so one tape can be reused for many short runs.
+    void reset(unsigned sz){
+        for (int64_t chunk = leftEdge >> CHUNK_BITS; chunk <= rightEdge >> CHUNK_BITS; chunk++){
+            uint8_t*& cells = chunkSlot(chunk);
+            if (cells == nullptr){continue;}
+            if (bits != 0){
+                // whole chunks, packed and windowed
+                delete[] cells;
+                cells = blankChunk();
+                for (Window& w : windows){
+                    if (w.chunk == chunk){
+                        std::fill(w.cells, w.cells + CHUNK_CELLS, (uint8_t)fill);
+                    }
+                }
+                continue;
+            }
+            int64_t from = std::max(leftEdge, chunk * CHUNK_CELLS);
+            int64_t to = std::min(rightEdge, (chunk * CHUNK_CELLS) + CHUNK_MASK);
+            std::fill(cells + (from & CHUNK_MASK), cells + (to & CHUNK_MASK) + 1, (uint8_t)fill);
+        }
+        head = 0;
+        leftEdge = 0;
+        rightEdge = (int64_t)sz - 1;
+        for (vector<Stain*>* side : {&rightStains, &leftStains}){
+            for (Stain* stains : *side){
+                if (stains != nullptr){
+                    std::fill(stains, stains + CHUNK_CELLS, UNSTAINED);
+                }
+            }
+        }
+        cellsInUse = 0;
+        current = chunkAt(0);
+        if (fill != S_){
+            for (int64_t i = 0; i < (int64_t)sz; i++){
+                chunkAt(i >> CHUNK_BITS)[i & CHUNK_MASK] = S_;
+            }
+        }
+    }
+
+    int64_t getHead() const {return head;}
+
+    int64_t getLeftEdge() const {return leftEdge;}
+
+    int64_t getRightEdge() const {return rightEdge;}
+
+    // what unvisited cells beyond the initial ones hold
+    Symbol getFill() const {return fill;}
+
+    uint64_t getSize() const {
+        return rightEdge - leftEdge + 1;
+    }
+
+    Symbol read() const {
+        return (Symbol)current[head & CHUNK_MASK];
+    }
+
+    Symbol readAt(int64_t i) const {
+        const uint8_t* cells = findChunk(i >> CHUNK_BITS);
+        if (bits != 0 && cells != nullptr){
+            const Window* w = windowOf(i >> CHUNK_BITS);
+            return w ? (Symbol)w->cells[i & CHUNK_MASK] : (Symbol)symbolOf[codeAt(cells, i & CHUNK_MASK)];
         }
-        return toSym.at("S_");
+        return cells == nullptr ? fill : (Symbol)cells[i & CHUNK_MASK];
     }
 
-    Symbol readAt(unsigned i){
-        char vl = values[i];
-        for (const auto& pair : toStr){
-            if (pair.second == vl){return pair.first;}
+    // Bulk read of cells [start, start + n) into out, one Symbol per byte,
+    // a chunk at a time.
+    void unpack(int64_t start, size_t n, uint8_t* out) const {
+        while (n > 0){
+            int64_t offset = start & CHUNK_MASK;
+            size_t run = std::min<size_t>(n, CHUNK_CELLS - offset);
+            const uint8_t* cells = findChunk(start >> CHUNK_BITS);
+            const Window* w = bits != 0 ? windowOf(start >> CHUNK_BITS) : nullptr;
+            if (cells == nullptr){
+                std::fill(out, out + run, (uint8_t)fill);
+            }
+            else if (bits == 0 || w != nullptr){
+                const uint8_t* from = (w ? w->cells : cells) + offset;
+                std::copy(from, from + run, out);
+            }
+            else{
+                for (size_t j = 0; j < run; j++){
+                    out[j] = symbolOf[codeAt(cells, offset + j)];
+                }
+            }
+            start += run;
+            out += run;
+            n -= run;
         }
-        return toSym.at("S_");
     }
 
-    string readStr(int displacement = 0){
-        return string(1, values[std::min(std::max(((int)head + displacement), 0), (const int) size)]);
+    string readStr(int displacement = 0) const {
+        int64_t i = std::min(std::max(head + displacement, leftEdge), rightEdge);
+        return string(1, symToChar[readAt(i)]);
     }
 
     void write(Symbol s){
-        values[head] = toStr.at(s);
+        current[head & CHUNK_MASK] = s;
     }
 
-    void right(){
-        if (head + 1 == size){
-            size += 10;
-            char* newArr = new char[size];
-            for (unsigned i = 0; i < size; i++){
-                if (i < size - 10){
-                    newArr[i] = values[i];
-                }
-                else{
-                    newArr[i] = toStr.at(toSym.at(tapeFill));
-                    cellColors[i] = graphics::WHITE;
+    // Direct access to cells [start, start + n) when they lie in one chunk,
+    // nullptr otherwise. When packed, the pointer stays good until two
+    // other chunks have been paged in, and writes through it must be
+    // symbols of the alphabet.
+    uint8_t* cellRun(int64_t start, unsigned n){
+        int64_t offset = start & CHUNK_MASK;
+        return offset + n <= CHUNK_CELLS ? chunkAt(start >> CHUNK_BITS) + offset : nullptr;
+    }
+
+    void writeAt(int64_t i, Symbol s){
+        if (bits != 0 && windowOf(i >> CHUNK_BITS) == nullptr){
+            // leave the windows to the head
+            uint8_t*& packed = chunkSlot(i >> CHUNK_BITS);
+            if (packed == nullptr){
+                packed = blankChunk();
+            }
+            if (codeOf[s] == 0xFF){
+                throw std::invalid_argument("Symbol is not in the packed tape's alphabet");
+            }
+            setCode(packed, i & CHUNK_MASK, codeOf[s]);
+            return;
+        }
+        chunkAt(i >> CHUNK_BITS)[i & CHUNK_MASK] = s;
+    }
+
+    // Widens the tape's extent to take in cells [from, to] without moving
+    // the head, for engines that track the head themselves.
+    void reach(int64_t from, int64_t to){
+        leftEdge = std::min(leftEdge, from);
+        rightEdge = std::max(rightEdge, to);
+    }
+
+    // Switches to packed storage for a tape whose cells only ever hold
+    // symbols of alphabet (fill and whatever is already on the tape are
+    // added to it): 2 bits per cell for up to 4 symbols, 4 for up to 16,
+    // 5 for more. Returns the width chosen.
+    unsigned pack(const vector<Symbol>& alphabet){
+        if (image != nullptr){
+            throw std::invalid_argument("A file-backed tape can't be packed");
+        }
+        bool present[32] = {};
+        present[fill] = true;
+        for (Symbol s : alphabet){
+            present[s] = true;
+        }
+
+        // everything back to one byte per cell, then repack at the new width
+        vector<std::pair<int64_t, vector<uint8_t>>> cells;
+        for (int side = 0; side < 2; side++){
+            const vector<uint8_t*>& chunks = side == 0 ? rightChunks : leftChunks;
+            for (size_t i = 0; i < chunks.size(); i++){
+                if (chunks[i] == nullptr){continue;}
+                int64_t chunk = side == 0 ? (int64_t)i : -(int64_t)i - 1;
+                vector<uint8_t> plain(CHUNK_CELLS);
+                unpack(chunk * CHUNK_CELLS, CHUNK_CELLS, plain.data());
+                for (uint8_t s : plain){
+                    present[s] = true;
                 }
+                cells.emplace_back(chunk, std::move(plain));
+            }
+        }
+        freeChunks();
+
+        unsigned count = 0;
+        std::fill(codeOf, codeOf + 32, 0xFF);
+        for (unsigned s = 0; s < 32; s++){
+            if (present[s]){
+                symbolOf[count] = s;
+                codeOf[s] = count++;
+            }
+        }
+        bits = count <= 4 ? 2 : count <= 16 ? 4 : 5;
+        for (Window& w : windows){
+            w.cells = new uint8_t[CHUNK_CELLS];
+        }
+        for (const auto& [chunk, plain] : cells){
+            uint8_t*& packed = chunkSlot(chunk);
+            packed = new uint8_t[chunkBytes()];
+            std::fill(packed, packed + chunkBytes(), 0);
+            packChunk(plain.data(), packed);
+        }
+        current = chunkAt(head >> CHUNK_BITS);
+        return bits;
+    }
+
+    // Moves the tape into a sparse file at path (created or truncated),
+    // with room for reserveCells cells either side of cell 0. Throws
+    // std::runtime_error if the file can't be set up.
+    void mapFile(const string& path, uint64_t reserveCells){
+#if TM_HAVE_MMAP
+        if (bits != 0){
+            throw std::invalid_argument("A packed tape can't be file-backed");
+        }
+        if (image != nullptr){
+            throw std::invalid_argument("Tape is already file-backed");
+        }
+        int64_t chunks = (reserveCells + CHUNK_CELLS - 1) / CHUNK_CELLS;
+        if (leftEdge < -chunks * CHUNK_CELLS || rightEdge >= chunks * CHUNK_CELLS){
+            throw std::invalid_argument("Tape is already wider than the reserve");
+        }
+        size_t bytes = IMAGE_HEADER_BYTES + 2 * chunks * CHUNK_CELLS;
+        int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0){
+            throw std::runtime_error("Failed to open tape file: " + path);
+        }
+        if (ftruncate(fd, bytes) != 0){
+            close(fd);
+            throw std::runtime_error("Failed to size tape file: " + path);
+        }
+        void* mapped = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_NORESERVE, fd, 0);
+        if (mapped == MAP_FAILED){
+            close(fd);
+            throw std::runtime_error("Failed to map tape file: " + path);
+        }
+
+        // copy the heap chunks in, then point the directories at the file
+        uint8_t* base = (uint8_t*)mapped + IMAGE_HEADER_BYTES + chunks * CHUNK_CELLS;
+        for (int side = 0; side < 2; side++){
+            vector<uint8_t*>& chunkList = side == 0 ? rightChunks : leftChunks;
+            for (size_t i = 0; i < chunkList.size(); i++){
+                if (chunkList[i] == nullptr){continue;}
+                int64_t chunk = side == 0 ? (int64_t)i : -(int64_t)i - 1;
+                uint8_t* cells = base + chunk * CHUNK_CELLS;
+                std::copy(chunkList[i], chunkList[i] + CHUNK_CELLS, cells);
+                delete[] chunkList[i];
+                chunkList[i] = cells;
             }
-            delete[] values;
-            values = newArr;
         }
+        image = (uint8_t*)mapped;
+        cellBase = base;
+        imageBytes = bytes;
+        reserveChunks = chunks;
+        imageFd = fd;
+        current = chunkAt(head >> CHUNK_BITS);
+        writeHeader();
+#else
+        throw std::runtime_error("File-backed tapes need mmap");
+#endif
+    }
+
+    // Brings the image's header up to date and asks the OS to start
+    // writing dirty pages back; the destructor does the same.
+    void syncImage(){
+#if TM_HAVE_MMAP
+        if (image == nullptr){return;}
+        writeHeader();
+        msync(image, imageBytes, MS_ASYNC);
+#endif
+    }
+
+    bool isFileBacked() const {
+        return image != nullptr;
+    }
+
+    // bits per cell when packed, 0 for one byte per cell
+    unsigned packedBits() const {
+        return bits;
+    }
+
+    // bytes held by chunks and windows
+    uint64_t memoryUsed() const {
+        uint64_t bytes = 0;
+        for (int side = 0; side < 2; side++){
+            for (const uint8_t* cells : side == 0 ? rightChunks : leftChunks){
+                bytes += cells ? chunkBytes() : 0;
+            }
+        }
+        return bytes + (bits != 0 ? 2 * CHUNK_CELLS : 0);
+    }
+
+    // Puts the head on cell i, extending the tape's edges if needed.
+    void moveTo(int64_t i){
+        head = i;
+        current = chunkAt(head >> CHUNK_BITS);
+        leftEdge = std::min(leftEdge, head);
+        rightEdge = std::max(rightEdge, head);
+    }
+
+    void right(){
         head++;
+        if ((head & CHUNK_MASK) == 0){
+            current = chunkAt(head >> CHUNK_BITS);
+        }
+        if (head > rightEdge){
+            rightEdge = head;
+        }
     }
 
     void left(){
-        if (head == 0){
-            size += 10;
-            char* newArr = new char[size];
-            
-            for (int i = 0; i < 10; i++){
-                newArr[i] = toStr.at(toSym.at(tapeFill));
-                cellColors[i] = graphics::WHITE;
+        if ((head & CHUNK_MASK) == 0){
+            current = chunkAt((head - 1) >> CHUNK_BITS);
+        }
+        head--;
+        if (head < leftEdge){
+            leftEdge = head;
+        }
+    }
+
+    // Moves the head right across the run of cells, starting at the head,
+    // whose symbols are in mask, passing over at most max cells. Returns the
+    // number of cells passed; the head ends on the first cell outside mask.
+    uint64_t sweepRight(uint32_t mask, uint64_t max){
+        uint64_t passed = 0;
+        while (passed < max){
+            int64_t offset = head & CHUNK_MASK;
+            uint64_t n = std::min<uint64_t>(CHUNK_CELLS - offset, max - passed);
+            uint64_t run = matchingPrefix(current + offset, n, mask);
+            passed += run;
+            head += run;
+            if ((head & CHUNK_MASK) == 0 && run > 0){
+                current = chunkAt(head >> CHUNK_BITS);
             }
-            
-            for (unsigned i = 10; i < size; i++){
-                newArr[i] = values[i-10];
+            if (run < n){
+                break;
             }
-            
-            unordered_map<unsigned, string> newColors;
-            for (auto& [idx, color] : cellColors) {
-                if (idx < size - 10) {
-                    newColors[idx + 10] = color;
-                }
+        }
+        if (head > rightEdge){
+            rightEdge = head;
+        }
+        return passed;
+    }
+
+    // Mirror image of sweepRight().
+    uint64_t sweepLeft(uint32_t mask, uint64_t max){
+        uint64_t passed = 0;
+        while (passed < max){
+            int64_t offset = head & CHUNK_MASK;
+            uint64_t n = std::min<uint64_t>(offset + 1, max - passed);
+            uint64_t run = matchingSuffix(current + offset + 1 - n, n, mask);
+            passed += run;
+            if (run == (uint64_t)offset + 1){
+                head -= run;
+                current = chunkAt(head >> CHUNK_BITS);
+                continue;
             }
-            cellColors = newColors;
-            
-            delete[] values;
-            values = newArr;
-            head = 9;
+            head -= run;
+            break;
         }
-        else{
-            head--;
+        if (head < leftEdge){
+            leftEdge = head;
         }
+        return passed;
     }
 
-    unsigned getSize(){
-        return size;
+    // Bulk write of n cells from cells (one Symbol per byte) starting at
+    // cell start; the inverse of unpack(). Edges and head are left alone.
+    void load(int64_t start, const uint8_t* cells, size_t n){
+        while (n > 0){
+            int64_t offset = start & CHUNK_MASK;
+            size_t run = std::min<size_t>(n, CHUNK_CELLS - offset);
+            uint8_t* to = chunkAt(start >> CHUNK_BITS) + offset;
+            std::copy(cells, cells + run, to);
+            start += run;
+            cells += run;
+            n -= run;
+        }
+        current = chunkAt(head >> CHUNK_BITS);
+    }
+
+    Stain stainAt(int64_t i) const {
+        const Stain* stains = findStains(i >> CHUNK_BITS);
+        return stains == nullptr ? UNSTAINED : stains[i & CHUNK_MASK];
+    }
+
+    // Bulk read of the stains of cells [start, start + n) into out.
+    void stainsIn(int64_t start, size_t n, Stain* out) const {
+        while (n > 0){
+            int64_t offset = start & CHUNK_MASK;
+            size_t run = std::min<size_t>(n, CHUNK_CELLS - offset);
+            const Stain* stains = findStains(start >> CHUNK_BITS);
+            if (stains == nullptr){
+                std::fill(out, out + run, UNSTAINED);
+            }
+            else{
+                std::copy(stains + offset, stains + offset + run, out);
+            }
+            start += run;
+            out += run;
+            n -= run;
+        }
+    }
+
+    // stain a cell (UNSTAINED clears it), keeping cellsInUse up to date
+    void stain(int64_t i, Stain s){
+        Stain*& stains = stainSlot(i >> CHUNK_BITS);
+        if (stains == nullptr){
+            if (s == UNSTAINED){return;}
+            stains = new Stain[CHUNK_CELLS]();
+        }
+        Stain& cell = stains[i & CHUNK_MASK];
+        if (cell == UNSTAINED && s != UNSTAINED){
+            cellsInUse++;
+        }
+        else if (cell != UNSTAINED && s == UNSTAINED){
+            cellsInUse--;
+        }
+        cell = s;
+    }
+
+    // f(cell, stain) for every stained cell, in order
+    template <typename F>
+    void forEachStain(F f) const {
+        for (int64_t chunk = -(int64_t)leftStains.size(); chunk < (int64_t)rightStains.size(); chunk++){
+            const Stain* stains = findStains(chunk);
+            if (stains == nullptr){continue;}
+            for (int64_t j = 0; j < CHUNK_CELLS; j++){
+                if (stains[j] != UNSTAINED){
+                    f(chunk * CHUNK_CELLS + j, stains[j]);
+                }
+            }
+        }
     }
 
     friend ostream& operator<<(ostream& ss, const Tape& tp){
-        ss << tp.toString(tp.size, 1);
+        ss << tp.toString(tp.getSize(), 1);
         return ss;
     }
 
-    string toString(unsigned len, unsigned step) const {
+    string toString(uint64_t len, unsigned step) const {
         stringstream ss;
-        
-        if (len >= size) {
-            ss << '|';
-            
-            for (unsigned i = 0; i < size; i += step) {
-                if (i == head) {
-                    ss << "{\\  " << values[i] << "  /}";
-                } else {
-                    ss << values[i];
-                }
-                ss << '|';
-            }
-            
-            return ss.str();
+        int64_t start = leftEdge;
+        int64_t end = rightEdge + 1;
+
+        if (len < getSize()) {
+            int64_t halfLen = len / 2;
+            start = std::max(head - halfLen, leftEdge);
+            end = std::min(head + halfLen + 1, rightEdge + 1);
         }
         
-        unsigned halfLen = len / 2;
-        unsigned start = (head > halfLen) ? (head - halfLen) : 0;
-        unsigned end = std::min(head + halfLen + 1, size);
-        
-        if (start > 0) {
-            ss << "......[" << start << "]......";
+        if (start > leftEdge) {
+            ss << "......[" << start - leftEdge << "]......";
         }
         
         ss << '|';
-        
-        for (unsigned i = start; i < end; i += step) {
+
+        vector<uint8_t> cells(end - start);
+        unpack(start, cells.size(), cells.data());
+        for (int64_t i = start; i < end; i += step) {
             if (i == head) {
-                ss << "{\\  " << values[i] << "  /}";
+                ss << "{\\  " << symToChar[cells[i - start]] << "  /}";
             } else {
-                ss << values[i];
+                ss << symToChar[cells[i - start]];
             }
             ss << '|';
         }
         
-        if (end < size) {
-            ss << "......[" << (size - end) << "]......";
+        if (end <= rightEdge) {
+            ss << "......[" << (rightEdge + 1 - end) << "]......";
         }
         
         return ss.str();
@@ -403,184 +1177,840 @@ class Tape{
 
 };
 
-class TM{
-    const unsigned MAX_TAPE = 999; 
+// Dense, hash-free form of a machine's transition function, built once by
+// TM::compile() after parsing. States are numbered in the order they're
+// first defined; states that are only ever jumped to (never defined) are
+// appended after those and have a row of undefined transitions.
+struct Program{
+    static const unsigned NUM_SYMBOLS = 17;
+    static const uint32_t HALT_ID = 0xFFFFFFFF;
+    static const uint32_t UNDEFINED_ID = 0xFFFFFFFE;
+
+    struct Transition{
+        uint32_t next;      // next state ID, HALT_ID, or UNDEFINED_ID if there is no transition
+        uint8_t write;      // Symbol
+        uint8_t move;       // Direction
+        uint8_t sweep;      // 1 if it writes back what it read and moves on in the same state
+    };
+
+    vector<Transition> table;   // [state * NUM_SYMBOLS + symbol]
+    vector<string> stateNames;
+    uint32_t start = HALT_ID;
+    // [state * 2 + direction]: symbols a state sweeps over moving LEFT/RIGHT
+    vector<uint32_t> sweepMasks;
+
+    const Transition& at(uint32_t state, Symbol symbol) const {
+        return table[state * NUM_SYMBOLS + symbol];
+    }
+
+    unsigned stateCount() const {
+        return stateNames.size();
+    }
+
+    uint32_t sweepMask(uint32_t state, uint8_t direction) const {
+        return sweepMasks[state * 2 + direction];
+    }
+
+    // Marks the self-looping "sweep" transitions, e.g.
+    // MOVE_X - S1 - S1 - R - MOVE_X, which the step engine can run over
+    // a whole stretch of tape in one go.
+    void findSweeps(){
+        sweepMasks.assign(stateCount() * 2, 0);
+        for (uint32_t state = 0; state < stateCount(); state++){
+            for (unsigned sym = 0; sym < NUM_SYMBOLS; sym++){
+                Transition& t = table[state * NUM_SYMBOLS + sym];
+                t.sweep = t.next == state && t.write == sym && t.move != NONE;
+                if (t.sweep){
+                    sweepMasks[state * 2 + t.move] |= 1u << sym;
+                }
+            }
+        }
+    }
+
+    // symbols the program reads or writes, in Symbol order
+    vector<Symbol> alphabet() const {
+        bool used[NUM_SYMBOLS] = {};
+        for (size_t i = 0; i < table.size(); i++){
+            if (table[i].next != UNDEFINED_ID){
+                used[i % NUM_SYMBOLS] = true;
+                used[table[i].write] = true;
+            }
+        }
+        vector<Symbol> symbols;
+        for (unsigned s = 0; s < NUM_SYMBOLS; s++){
+            if (used[s]){symbols.push_back((Symbol)s);}
+        }
+        return symbols;
+    }
+
+    string nameOf(uint32_t state) const {
+        if (state == HALT_ID){return "HALT";}
+        if (state == UNDEFINED_ID){return "UNDEFINED";}
+        return stateNames[state];
+    }
+};
+
+// Standard description of prog's defined transitions, state by state and
+// symbol by symbol, numbered as TM::getFullSD(): HALT is 0, state ID i is
+// i + 1.
+inline string standardDescription(const Program& prog){
+    stringstream ss;
+    for (uint32_t state = 0; state < prog.stateCount(); state++){
+        for (unsigned sym = 0; sym < Program::NUM_SYMBOLS; sym++){
+            const Program::Transition& t = prog.at(state, (Symbol)sym);
+            if (t.next == Program::UNDEFINED_ID){continue;}
+            uint32_t next = t.next == Program::HALT_ID ? 0 : t.next + 1;
+            ss << 'D' << string(state + 1, 'C')
+               << 'D' << string(symInd.at((Symbol)sym), 'A')
+               << 'D' << string(symInd.at((Symbol)t.write), 'A')
+               << (t.move == RIGHT ? 'R' : t.move == LEFT ? 'L' : 'N')
+               << 'D' << string(next, 'C');
+        }
+    }
+    return ss.str();
+}
+
+// Name given to state i of a machine loaded from a standard description:
+// A, B, ..., Z, AA, AB, ..., with HALT renamed HALT_.
+inline string sdStateName(uint32_t i){
+    string name;
+    for (uint64_t n = (uint64_t)i + 1; n > 0; n = (n - 1) / 26){
+        name.insert(name.begin(), 'A' + (n - 1) % 26);
+    }
+    return name == "HALT" ? name + "_" : name;
+}
+
+// SD number: each letter of sd replaced by its digit (see TM::sdint).
+inline string sdNumber(const string& sd){
+    stringstream ss;
+    for (char c : sd){
+        ss << sdToNum.at(c);
+    }
+    return ss.str();
+}
+
+// prog written back out as .javaturing transitions, one per defined slot.
+inline string programText(const Program& prog){
+    stringstream ss;
+    for (uint32_t state = 0; state < prog.stateCount(); state++){
+        for (unsigned sym = 0; sym < Program::NUM_SYMBOLS; sym++){
+            const Program::Transition& t = prog.at(state, (Symbol)sym);
+            if (t.next == Program::UNDEFINED_ID){continue;}
+            ss << prog.nameOf(state) << " - " << symToName[sym] << " - " << symToName[t.write] << " - "
+               << (t.move == RIGHT ? "R" : t.move == LEFT ? "L" : "N") << " - " << prog.nameOf(t.next) << "; ";
+        }
+    }
+    string text = ss.str();
+    rtrim(text);
+    return text;
+}
+
+// A .javaturing description that didn't parse, and where (1-based).
+class ParseError : public std::invalid_argument{
+
+    public:
+
+    const unsigned line;
+    const unsigned column;
+
+    ParseError(const string& message, unsigned l, unsigned c)
+        : std::invalid_argument("line " + std::to_string(l) + ", column " + std::to_string(c) + ": " + message), line(l), column(c) {}
+};
+
+// Why a run stopped.
+enum class HaltReason{
+    Halted, Undefined, StepLimit, TapeLimit, NonHalting
+};
+
+inline const char* haltReasonName(HaltReason reason){
+    switch (reason){
+        case HaltReason::Halted: return "halted";
+        case HaltReason::Undefined: return "undefined-transition";
+        case HaltReason::StepLimit: return "step-limit";
+        case HaltReason::TapeLimit: return "tape-limit";
+        case HaltReason::NonHalting: return "non-halting";
+    }
+    return "unknown";
+}
+
+struct RunResult{
+    uint64_t steps;
+    HaltReason reason;
+};
+
+// Steps prog on tape from state, with no I/O, until it halts, reaches an
+// undefined transition, has taken maxSteps steps or the tape has grown to
+// tapeLimit cells. state is left at the state the run stopped in.
+// With sweeps on, a sweep transition passes over its whole run of cells in
+// one tape scan; step counts and stopping points are the same either way.
+inline RunResult execute(const Program& prog, Tape& tape, uint32_t& state, uint64_t maxSteps, uint64_t tapeLimit, bool sweeps = true){
+    uint64_t steps = 0;
+    while (true){
+        if (state == Program::HALT_ID){
+            return {steps, HaltReason::Halted};
+        }
+        if (tape.getSize() >= tapeLimit){
+            return {steps, HaltReason::TapeLimit};
+        }
+        if (steps == maxSteps){
+            return {steps, HaltReason::StepLimit};
+        }
+        const Program::Transition& transition = prog.at(state, tape.read());
+        if (transition.next == Program::UNDEFINED_ID){
+            return {steps, HaltReason::Undefined};
+        }
+
+        if (sweeps && transition.sweep){
+            // stop where the plain loop would: out of steps, or on the cell
+            // that makes the tape tapeLimit wide
+            uint64_t budget = maxSteps - steps;
+            int64_t room;
+            uint64_t passed;
+            if (transition.move == RIGHT){
+                room = tape.getLeftEdge() + (int64_t)tapeLimit - 1 - tape.getHead();
+                passed = tape.sweepRight(prog.sweepMask(state, RIGHT), std::min<uint64_t>(budget, room));
+            }
+            else{
+                room = tape.getHead() - (tape.getRightEdge() - (int64_t)tapeLimit + 1);
+                passed = tape.sweepLeft(prog.sweepMask(state, LEFT), std::min<uint64_t>(budget, room));
+            }
+            steps += passed;
+            continue;
+        }
+
+        tape.write((Symbol)transition.write);
+        if (transition.move == LEFT){
+            tape.left();
+        }
+        else if (transition.move == RIGHT){
+            tape.right();
+        }
+        state = transition.next;
+        steps++;
+    }
+}
+
+// labels-as-values dispatch where the compiler has it, a switch otherwise
+#if defined(__GNUC__) || defined(__clang__)
+#define TM_COMPUTED_GOTO 1
+#else
+#define TM_COMPUTED_GOTO 0
+#endif
 
-    enum Direction{
-        LEFT, RIGHT, NONE
+// Threaded-code form of a Program, the second interpreter backend. Each
+// [state][symbol] slot is pre-decoded into an Op that carries the address
+// of its handler and a pointer to the next state's row, so a step is the
+// handler's own work plus one indirect jump to the next handler. Same
+// contract as execute() (without sweeps).
+class ThreadedCode{
+
+    public:
+
+    enum Kind : uint8_t{
+        OP_RIGHT, OP_LEFT, OP_STAY, OP_HALT, OP_UNDEFINED
     };
 
+    struct Op{
+        const void* handler;    // label in interpret(), when TM_COMPUTED_GOTO
+        const Op* next;         // row of the next state, nullptr for HALT
+        uint8_t write;
+        uint8_t kind;
+        uint8_t move;           // only read by OP_HALT
+    };
+
+    private:
+
+    vector<Op> ops;     // [state * NUM_SYMBOLS + symbol], same layout as Program::table
+
+    // With labels set, only hands back the handler addresses.
+    static RunResult interpret(const Op* ops, uint32_t& state, Tape* tapePtr, uint64_t maxSteps, uint64_t tapeLimit, const void* const** labels = nullptr){
+#if TM_COMPUTED_GOTO
+        static const void* const handlers[] = {&&OP_RIGHT, &&OP_LEFT, &&OP_STAY, &&OP_HALT, &&OP_UNDEFINED};
+        if (labels != nullptr){
+            *labels = handlers;
+            return {0, HaltReason::Halted};
+        }
+#define TM_OP(kind) kind:
+#define TM_DISPATCH() goto *op->handler
+#else
+        if (labels != nullptr){
+            *labels = nullptr;
+            return {0, HaltReason::Halted};
+        }
+#define TM_OP(kind) case kind:
+#define TM_DISPATCH() goto dispatch
+#endif
+#define TM_ADVANCE() steps++; row = op->next; if (steps == maxSteps){goto stepLimit;} op = row + *cell; TM_DISPATCH()
+
+        Tape& tape = *tapePtr;
+        if (state == Program::HALT_ID){
+            return {0, HaltReason::Halted};
+        }
+        if (tape.getSize() >= tapeLimit){
+            return {0, HaltReason::TapeLimit};
+        }
+        if (maxSteps == 0){
+            return {0, HaltReason::StepLimit};
+        }
+
+        // head and edges live in locals; cell points into the head's chunk,
+        // and [fastLo, fastHi] is where the head can go without touching
+        // a chunk boundary or an edge
+        int64_t head = tape.getHead();
+        int64_t lo = tape.getLeftEdge();
+        int64_t hi = tape.getRightEdge();
+        int64_t limit = tapeLimit > (uint64_t)INT64_MAX ? INT64_MAX : (int64_t)tapeLimit;
+        int64_t fastLo, fastHi;
+        uint8_t* cell;
+        auto locate = [&]{
+            int64_t first = head & ~Tape::CHUNK_MASK;
+            cell = tape.cellRun(first, Tape::CHUNK_CELLS) + (head - first);
+            fastLo = std::max(lo, first);
+            fastHi = std::min(hi, first + Tape::CHUNK_MASK);
+        };
+        locate();
+
+        uint64_t steps = 0;
+        HaltReason reason = HaltReason::Halted;
+        const Op* row = ops + state * Program::NUM_SYMBOLS;
+        const Op* op = row + *cell;
+        TM_DISPATCH();
+
+#if !TM_COMPUTED_GOTO
+        dispatch:
+        switch (op->kind){
+#endif
+        TM_OP(OP_RIGHT)
+            *cell++ = op->write;
+            if (++head > fastHi){
+                if (head > hi){
+                    hi = head;
+                    if (hi - lo + 1 >= limit){
+                        steps++;
+                        row = op->next;
+                        reason = HaltReason::TapeLimit;
+                        goto done;
+                    }
+                }
+                locate();
+            }
+            TM_ADVANCE();
+
+        TM_OP(OP_LEFT)
+            *cell-- = op->write;
+            if (--head < fastLo){
+                if (head < lo){
+                    lo = head;
+                    if (hi - lo + 1 >= limit){
+                        steps++;
+                        row = op->next;
+                        reason = HaltReason::TapeLimit;
+                        goto done;
+                    }
+                }
+                locate();
+            }
+            TM_ADVANCE();
+
+        TM_OP(OP_STAY)
+            *cell = op->write;
+            TM_ADVANCE();
+
+        TM_OP(OP_HALT)
+            *cell = op->write;
+            head += op->move == RIGHT ? 1 : op->move == LEFT ? -1 : 0;
+            lo = std::min(lo, head);
+            hi = std::max(hi, head);
+            steps++;
+            row = nullptr;
+            goto done;
+
+        TM_OP(OP_UNDEFINED)
+            reason = HaltReason::Undefined;
+            goto done;
+#if !TM_COMPUTED_GOTO
+        }
+#endif
+
+        stepLimit:
+        reason = HaltReason::StepLimit;
+
+        done:
+        state = row == nullptr ? Program::HALT_ID : (row - ops) / Program::NUM_SYMBOLS;
+        tape.reach(lo, hi);
+        tape.moveTo(head);
+        return {steps, reason};
+#undef TM_ADVANCE
+#undef TM_DISPATCH
+#undef TM_OP
+    }
+
+    public:
+
+    ThreadedCode(const Program& prog){
+        const void* const* labels;
+        uint32_t unused = 0;
+        interpret(nullptr, unused, nullptr, 0, 0, &labels);
+
+        ops.resize(prog.table.size());
+        for (size_t i = 0; i < ops.size(); i++){
+            const Program::Transition& t = prog.table[i];
+            Op& op = ops[i];
+            op.write = t.write;
+            op.move = t.move;
+            op.next = t.next < prog.stateCount() ? &ops[t.next * Program::NUM_SYMBOLS] : nullptr;
+            op.kind = t.next == Program::UNDEFINED_ID ? OP_UNDEFINED
+                    : t.next == Program::HALT_ID ? OP_HALT
+                    : t.move == RIGHT ? OP_RIGHT : t.move == LEFT ? OP_LEFT : OP_STAY;
+            op.handler = labels == nullptr ? nullptr : labels[op.kind];
+        }
+    }
+
+    // ops point into each other, so no copies
+    ThreadedCode(const ThreadedCode&) = delete;
+    ThreadedCode& operator=(const ThreadedCode&) = delete;
+
+    RunResult run(Tape& tape, uint32_t& state, uint64_t maxSteps, uint64_t tapeLimit) const {
+        return interpret(ops.data(), state, &tape, maxSteps, tapeLimit);
+    }
+};
+
+// Step loops TM::runHeadless() can use.
+enum class Engine{
+    Table,      // execute(): table lookups, with sweeps
+    Threaded    // ThreadedCode
+};
+
+class TM{
+    const unsigned MAX_TAPE = 999; 
+
     struct Configuration{
         unsigned index;
         Symbol readSymbol;
         Symbol writeSymbol;
         Direction direction;
-        string nextConfig;
+        // next state and symbol read, as "NEXT{'r'}"; filled in by
+        // collectSignatures(), as only the visualizer needs it
         string signature;
 
-        string sd;
-        string sdSig;
-        string sdNum;
+        unsigned stateNo = 0;   // numbers of the state's and next state's names
+        unsigned nextNo = 0;
 
-        Configuration(const unsigned idx, Symbol rd, const Symbol wt, const Direction d, const string nxt):
+        Configuration(const unsigned idx, Symbol rd, const Symbol wt, const Direction d):
         index(idx),
         readSymbol(rd), 
         writeSymbol(wt), 
-        direction(d), 
-        nextConfig(nxt),
-        signature(nextConfig + "{\'" + toStr.at(readSymbol) + "\'}")
+        direction(d)
         {}
     };
 
     private:
 
-    unordered_map<string, unordered_map<Symbol, Configuration>> head;
-    string currentState;
+    // every define() in order; a later definition of the same state and
+    // symbol replaces an earlier one when compiled
+    vector<Configuration> configurations;
+    string initialState;
+    uint32_t currentState = Program::HALT_ID;
     Tape& tape;    
-    unsigned sizeLimit;
+    uint64_t sizeLimit;
 
+    // the standard description, only spelled out when something asks for it
     string fullSD;
-
-    unordered_set<string> configs;
-    unordered_map<string, unsigned> configIds;
+    size_t sdWritten = 0;   // configurations already in fullSD
+
+    // every state name (and HALT) interned once, numbered in order of first
+    // mention
+    vector<string> names;
+    // open-addressed index into names: the name's hash in the high half,
+    // its name number + 1 in the low half, 0 for an empty slot
+    vector<uint64_t> nameSlots;
+    vector<int> configIdOf;     // [name number]: order first defined in, or -1
+    vector<unsigned> sdNumberOf; // [name number]: state number in the SD, see getFullSD()
+    unsigned lastDefined = 0;   // name number of the state define() saw last
+    unsigned configCount = 0;
     vector<string> signatures;
     unordered_map<string, int> signatureToCongifIndex;
-    vector<string> standardDesctription;
-    vector<string> sdSignatures;
-    vector<string> SDNum;
+    size_t signaturesSeen = 0;  // configurations already in signatures
     unordered_map<string, unsigned> sigToScale; // signature -> signatureIndex
     unordered_map<unsigned, unsigned> scaleToGene; // sigScale -> x coordinate on genome (genome now a bar up top)
     unordered_map<string, string> sigToColor;
+    // Tape::Stain -> color, UNSTAINED being WHITE, and signatureIndex ->
+    // Tape::Stain; built by initializeColors()
+    vector<string> stainColors;
+    vector<SpaceTimeDiagram::Color> stainRgb;
+    vector<Tape::Stain> signatureStains;
+
+    // graphics::Window groups the visualization redraws separately; pixel
+    // column j of the whole-tape overview is group WHOLE_TAPE_GROUPS + j
+    enum VizGroup{
+        TAPE_GROUP = 1,
+        STATS_GROUP,
+        GENOME_GROUP,
+        GENE_GROUP,
+        HEAD_GROUP,
+        BINDING_GROUP,
+        SLIDER_GROUP,
+        SPACE_TIME_GROUP,
+        WHOLE_TAPE_GROUPS
+    };
+    // The whole-tape overview draws each pixel column as the average of
+    // its cells' shades: their stain and their binary view colors, summed
+    // by tapeShades as differences from a blank cell's.
+    typedef TapeSums<6> ShadeSums;
+    ShadeSums tapeShades;
+    ShadeSums::Sums blankShade{};
+    // cells shown, from first; all of them, following the tape, if fit
+    struct OverviewView{
+        bool fit = true;
+        int64_t first = 0;
+        int64_t cells = 1;
+    };
+    OverviewView overview;
+    // each column's colors as last drawn, stain << 24 | binary view, and
+    // the cells they were for; a column is drawn again when these change
+    vector<uint64_t> overviewColumns;
+    int64_t overviewFirst = 0;
+    int64_t overviewCells = 0;
+    // a drag across the overview pans it
+    bool panningOverview = false;
+    int panFromX = 0;
+    int64_t panFromFirst = 0;
+
+    // What the simulation thread hands the window: where the machine is
+    // after steps steps, and the cells written since the last snapshot,
+    // each with the stain of the configuration that wrote it.
+    struct DirtyCell{
+        int64_t cell;
+        Symbol symbol;
+        Tape::Stain stain;
+    };
+    struct StepSnapshot{
+        uint64_t steps = 0;
+        uint32_t state = Program::HALT_ID;
+        int64_t head = 0;
+        int64_t leftEdge = 0;
+        int64_t rightEdge = 0;
+        vector<DirtyCell> cells;
+        bool last = false;      // the simulation has stopped
+    };
+    static const size_t SNAPSHOT_SLOTS = 8;
+    typedef SpscRing<StepSnapshot, SNAPSHOT_SLOTS> SnapshotRing;
+
+    // compiled form of configurations, filled in by compile()
+    std::shared_ptr<const Program> program;
+    vector<const Configuration*> configTable; // same layout as program->table
+    std::shared_ptr<const ThreadedCode> threaded; // only while engine is Threaded
+    Engine engine = Engine::Table;
     
+    // the visualization's speed control, 0 to SLIDER_MAX; see stepsPerSecond()
     int sliderValue = 500;
     bool draggingSlider = false;
+    static constexpr int SLIDER_MAX = 1000;
 
     public:
 
     TM(Tape& tp) : tape(tp), sizeLimit(999) {}
 
-    TM(Tape& tp, unsigned szLmt) : tape(tp), sizeLimit(szLmt) {}
+    TM(Tape& tp, uint64_t szLmt) : tape(tp), sizeLimit(szLmt) {}
 
     ~TM() {}
 
-    static TM* fromStandardDescription(string description, Tape& tape, unsigned szLmt){
-        bool foundInit = false;
-        TM* utm = new TM(tape, szLmt);
-
-        for (const string& line : split(description, ';')){
-            string nLine = line;
-            trim(nLine);
-            if (nLine.empty()){continue;}
-
-            vector<string> parts = split(nLine, '-');
-            if (parts.size() != 5){
-                throw new std::invalid_argument("Invalid Congfiguration Definition!");
+    // Machine from .javaturing text: "STATE - READ - WRITE - MOVE - NEXT;"
+    // transitions, after an optional header ending in #########. Reads the
+    // text in one pass without copying it; throws ParseError.
+    static TM* fromStandardDescription(std::string_view text, Tape& tape, uint64_t szLmt){
+        std::unique_ptr<TM> utm(new TM(tape, szLmt));
+
+        size_t pos = text.find("#########");
+        pos = pos == std::string_view::npos ? 0 : pos + 9;
+        auto fail = [&](size_t at, const string& message){
+            size_t lineStart = text.rfind('\n', at == 0 ? 0 : at - 1);
+            lineStart = lineStart == std::string_view::npos || at == 0 ? 0 : lineStart + 1;
+            unsigned line = 1 + std::count(text.begin(), text.begin() + lineStart, '\n');
+            throw ParseError(message, line, at - lineStart + 1);
+        };
+        auto isSpace = [](char c){
+            return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+        };
+
+        // one statement's five fields, trimmed, and where each starts
+        std::string_view fields[5];
+        size_t starts[5];
+        utm->configurations.reserve(std::count(text.begin() + pos, text.end(), ';'));
+        while (pos < text.size()){
+            // a statement runs to the next ';', or the end of the text
+            const char* semicolon = (const char*)memchr(text.data() + pos, ';', text.size() - pos);
+            size_t end = semicolon == nullptr ? text.size() : semicolon - text.data();
+            unsigned count = 0;
+            size_t fieldStart = pos;
+            while (true){
+                const char* dash = (const char*)memchr(text.data() + fieldStart, '-', end - fieldStart);
+                size_t sep = dash == nullptr ? end : dash - text.data();
+                if (count == 5){
+                    fail(fieldStart - 1, "expected ';' after the next state");
+                }
+                size_t b = fieldStart, e = sep;
+                while (b < e && isSpace(text[b])){b++;}
+                while (e > b && isSpace(text[e - 1])){e--;}
+                fields[count] = text.substr(b, e - b);
+                starts[count] = b;
+                count++;
+                if (sep == end){break;}
+                fieldStart = sep + 1;
+            }
+            pos = end + 1;
+            if (count == 1 && fields[0].empty()){
+                continue;
+            }
+            if (count != 5){
+                fail(starts[0], "expected STATE - READ - WRITE - MOVE - NEXT");
             }
 
-            try{
-                string state = parts[0];
-                trim(state);
-
-                string p1trim = parts[1];
-                trim(p1trim);
-                Symbol readSymbol = toSym.at(p1trim);
+            Symbol symbols[2];
+            for (unsigned f = 1; f <= 2; f++){
+                unsigned sym = 0;
+                while (sym < Program::NUM_SYMBOLS && fields[f] != symToName[sym]){sym++;}
+                if (sym == Program::NUM_SYMBOLS){
+                    fail(starts[f], "unknown symbol '" + string(fields[f]) + "'");
+                }
+                symbols[f - 1] = (Symbol)sym;
+            }
+            Direction direction = NONE;
+            if (fields[3] == "R"){direction = RIGHT;}
+            else if (fields[3] == "L"){direction = LEFT;}
+            else if (fields[3] != "N"){
+                fail(starts[3], "move must be R, L or N, not '" + string(fields[3]) + "'");
+            }
+            if (fields[0].empty()){
+                fail(starts[0], "missing state name");
+            }
+            if (fields[4].empty()){
+                fail(starts[4], "missing next state");
+            }
+            utm->define(fields[0], symbols[0], symbols[1], direction, fields[4]);
+        }
+        utm->compile();
+        return utm.release();
+    }
 
-                string p2trim = parts[2];
-                trim(p2trim);
-                Symbol writeSymbol = toSym.at(p2trim);
+    static TM* fromStandardDescription(std::istream& file, Tape& tp, uint64_t szLmt){
+        if (!file){
+            throw std::runtime_error("Failed to open file");
+        }
+        stringstream buffer;
+        buffer << file.rdbuf();
+        string content = buffer.str();
+        return fromStandardDescription(std::string_view(content), tp, szLmt);
+    }
 
-                string p3trim = parts[3];
-                trim(p3trim);
-                Direction direction = p3trim == "R" ? RIGHT : p3trim == "L" ? LEFT : NONE;
+    // Machine whose fullSD is sd, read in one pass. State 0 is HALT and
+    // state k > 0 is named sdStateName(k - 1); a jump to a state with no
+    // transitions of its own finds no transition, as in the original.
+    static TM* fromSD(std::string_view sd, Tape& tape, uint64_t szLmt){
+        struct Row{
+            uint32_t state;
+            unsigned read;
+            unsigned write;
+            Direction direction;
+            uint32_t next;
+        };
+        vector<Row> rows;
+        size_t i = 0;
+        auto expect = [&](char c){
+            if (i >= sd.size() || sd[i] != c){
+                throw std::invalid_argument("Invalid standard description at character " + std::to_string(i) + "!");
+            }
+            i++;
+        };
+        auto count = [&](char c){
+            size_t start = i;
+            while (i < sd.size() && sd[i] == c){i++;}
+            return i - start;
+        };
+
+        while (i < sd.size()){
+            Row row;
+            expect('D');
+            row.state = count('C');
+            expect('D');
+            row.read = count('A');
+            expect('D');
+            row.write = count('A');
+            char move = i < sd.size() ? sd[i] : '\0';
+            if (move != 'R' && move != 'L' && move != 'N'){
+                throw std::invalid_argument("Invalid standard description at character " + std::to_string(i) + "!");
+            }
+            row.direction = move == 'R' ? RIGHT : move == 'L' ? LEFT : NONE;
+            i++;
+            expect('D');
+            row.next = count('C');
+            if (row.read >= Program::NUM_SYMBOLS || row.write >= Program::NUM_SYMBOLS){
+                throw std::invalid_argument("Invalid symbol!");
+            }
+            if (row.state == 0){
+                throw std::invalid_argument("Standard description defines HALT at character " + std::to_string(i) + "!");
+            }
+            rows.push_back(row);
+        }
 
-                string nextState = parts[4];
-                trim(nextState);
+        auto name = [&](uint32_t k){ return k == 0 ? string("HALT") : sdStateName(k - 1); };
+        TM* utm = new TM(tape, szLmt);
+        for (const Row& row : rows){
+            utm->define(name(row.state), sdSymbols[row.read], sdSymbols[row.write], row.direction, name(row.next));
+        }
+        utm->compile();
+        return utm;
+    }
 
-                if (!foundInit){
-                    utm->currentState = state;
-                    foundInit = true;
-                }
+    // Machine from a description number (see sdint).
+    static TM* fromDN(std::string_view dn, Tape& tape, uint64_t szLmt){
+        static const char letters[] = "?DCARLN";
+        string sd(dn.size(), ' ');
+        for (size_t i = 0; i < dn.size(); i++){
+            if (dn[i] < '1' || dn[i] > '6'){
+                throw std::invalid_argument("Invalid description number at digit " + std::to_string(i) + "!");
+            }
+            sd[i] = letters[dn[i] - '0'];
+        }
+        return fromSD(sd, tape, szLmt);
+    }
 
-                unsigned idx;
-                if (utm->configs.count(state) == 0){
-                    idx = utm->configs.size();
-                    utm->configs.emplace(state);
-                    utm->configIds.emplace(state, idx);
-                }
-                else{
-                    idx = utm->configIds.at(state);
-                }
-                Configuration config = Configuration(idx, readSymbol, writeSymbol, direction, nextState);
-            
-                if (utm->sigToScale.find(config.signature) == utm->sigToScale.end()) {
-                    utm->sigToScale.emplace(config.signature, utm->signatures.size());
-                    utm->signatures.push_back(config.signature);
-                    utm->signatureToCongifIndex.emplace(config.signature, config.index);
-                }
+    // Machine running prog, with its transitions defined in table order.
+    static TM* fromProgram(const Program& prog, Tape& tape, uint64_t szLmt){
+        TM* utm = new TM(tape, szLmt);
+        for (uint32_t state = 0; state < prog.stateCount(); state++){
+            for (unsigned sym = 0; sym < Program::NUM_SYMBOLS; sym++){
+                const Program::Transition& t = prog.at(state, (Symbol)sym);
+                if (t.next == Program::UNDEFINED_ID){continue;}
+                utm->define(prog.stateNames[state], (Symbol)sym, (Symbol)t.write, (Direction)t.move, prog.nameOf(t.next));
+            }
+        }
+        utm->initialState = prog.start == Program::HALT_ID ? "" : prog.stateNames[prog.start];
+        utm->compile();
+        return utm;
+    }
 
-                config.sd = utm->sdify(config);
-                config.sdSig = utm->sdifySig(config);
-                config.sdNum = utm->sdint(config);
+    // Adds state's transition on readSymbol, in the order the machine's
+    // description lists it; the first state defined is the initial one.
+    void define(std::string_view state, Symbol readSymbol, Symbol writeSymbol, Direction direction, std::string_view nextState){
+        if (configCount == 0){
+            initialState.assign(state);
+        }
 
-                utm->addConfiguration(state, config);
+        // descriptions usually list a state's transitions together
+        unsigned from = configCount > 0 && names[lastDefined] == state ? lastDefined : mention(state);
+        unsigned to = mention(nextState);
+        lastDefined = from;
+        if (configIdOf[from] < 0){
+            configIdOf[from] = configCount++;
+        }
+        Configuration& config = configurations.emplace_back(configIdOf[from], readSymbol, writeSymbol, direction);
+        config.stateNo = from;
+        config.nextNo = to;
+    }
 
-                utm->standardDesctription.push_back(config.sd);
-                utm->fullSD += config.sd;
-                utm->sdSignatures.push_back(config.sdSig);
-                utm->SDNum.push_back(config.sdNum);
+    // number of a state name, interning it on first mention
+    unsigned mention(std::string_view name){
+        if (2 * (names.size() + 1) > nameSlots.size()){
+            vector<uint64_t> old(std::max<size_t>(1024, nameSlots.size() * 2), 0);
+            old.swap(nameSlots);
+            size_t mask = nameSlots.size() - 1;
+            for (uint64_t slot : old){
+                if (slot == 0){continue;}
+                size_t i = std::hash<std::string_view>()(names[(uint32_t)slot - 1]) & mask;
+                while (nameSlots[i] != 0){i = (i + 1) & mask;}
+                nameSlots[i] = slot;
             }
-            catch(std::invalid_argument e){
-                throw new std::invalid_argument("Invalid symbol!");
+        }
+        uint64_t hash = std::hash<std::string_view>()(name);
+        size_t mask = nameSlots.size() - 1;
+        size_t i = hash & mask;
+        for (; nameSlots[i] != 0; i = (i + 1) & mask){
+            uint32_t k = (uint32_t)nameSlots[i] - 1;
+            if ((nameSlots[i] >> 32) == (hash >> 32) && names[k] == name){
+                return k;
             }
         }
-        return utm;
+        nameSlots[i] = (hash >> 32) << 32 | (names.size() + 1);
+        names.emplace_back(name);
+        configIdOf.push_back(-1);
+        return names.size() - 1;
     }
 
-    static TM* fromStandardDescription(fstream& file, Tape& tp, unsigned szLmt){
-        string fileContent;
-        try {
-            if (!file.is_open()) {
-                throw std::runtime_error("Failed to open file");
-            }
-            
-            stringstream buffer;
-            buffer << file.rdbuf();
-            fileContent = buffer.str();
-            
-            size_t hashPos = fileContent.find("#########");
-            if (hashPos != string::npos) {
-                fileContent = fileContent.substr(hashPos + 9); // 9 is length of "#########"
+    // Fills in the genome's signatures for transitions defined since the
+    // last call; only the visualizer needs them.
+    void collectSignatures(){
+        for (; signaturesSeen < configurations.size(); signaturesSeen++){
+            Configuration& c = configurations[signaturesSeen];
+            c.signature = names[c.nextNo] + "{'" + toStr.at(c.readSymbol) + "'}";
+            if (sigToScale.find(c.signature) == sigToScale.end()) {
+                sigToScale.emplace(c.signature, signatures.size());
+                signatures.push_back(c.signature);
+                signatureToCongifIndex.emplace(c.signature, c.index);
             }
-            
-            replace(fileContent.begin(), fileContent.end(), '\t', ' ');
-            replace(fileContent.begin(), fileContent.end(), '\n', ' ');
-            
-        } catch (const std::exception& e) {
-            cerr << "Exception: " << e.what() << std::endl;
         }
-        
-        return fromStandardDescription(fileContent, tp, szLmt);
     }
 
-    void addConfiguration(const string& state, const Configuration& config) {
-        if (head.find(state) == head.end()) {
-            head.insert({state, unordered_map<Symbol, Configuration>()});
+    // Gives every state a dense ID and flattens head into a
+    // [state][symbol] table, so the run loops never hash a string.
+    void compile(){
+        std::shared_ptr<Program> prog = std::make_shared<Program>();
+        unsigned start = initialState.empty() ? 0 : mention(initialState);
+
+        // [name number] -> state ID; states that are jumped to (or started in)
+        // but never defined get their own (empty) rows after the rest
+        vector<uint32_t> ids(names.size(), (uint32_t)Program::HALT_ID);
+        prog->stateNames.resize(configCount);
+        for (unsigned k = 0; k < names.size(); k++){
+            if (names[k] == "HALT"){continue;}
+            if (configIdOf[k] >= 0){
+                ids[k] = configIdOf[k];
+                prog->stateNames[ids[k]] = names[k];
+            }
         }
-        
-        auto& stateMap = head.at(state);
-        
-        auto it = stateMap.find(config.readSymbol);
-        if (it != stateMap.end()) {
-            stateMap.erase(it);
+        for (unsigned k = 0; k < names.size(); k++){
+            if (names[k] != "HALT" && configIdOf[k] < 0){
+                ids[k] = prog->stateNames.size();
+                prog->stateNames.push_back(names[k]);
+            }
         }
-        
-        stateMap.insert({config.readSymbol, config});
+
+        prog->table.assign(prog->stateNames.size() * Program::NUM_SYMBOLS, Program::Transition());
+        configTable.assign(prog->table.size(), nullptr);
+        for (unsigned i = 0; i < prog->table.size(); i++){
+            prog->table[i] = {Program::UNDEFINED_ID, (uint8_t)(i % Program::NUM_SYMBOLS), NONE, 0};
+        }
+        for (const Configuration& config : configurations){
+            uint32_t id = ids[config.stateNo];
+            if (id == Program::HALT_ID){continue;}  // a state named HALT is never reached
+            size_t slot = (size_t)id * Program::NUM_SYMBOLS + config.readSymbol;
+            prog->table[slot] = {ids[config.nextNo], (uint8_t)config.writeSymbol, (uint8_t)config.direction, 0};
+            configTable[slot] = &config;
+        }
+
+        sdNumberOf.resize(names.size());
+        for (unsigned k = 0; k < names.size(); k++){
+            sdNumberOf[k] = ids[k] == Program::HALT_ID ? 0 : ids[k] + 1;
+        }
+
+        prog->findSweeps();
+        prog->start = initialState.empty() ? Program::HALT_ID : ids[start];
+        currentState = prog->start;
+        program = prog;
+        threaded = engine == Engine::Threaded ? std::make_shared<const ThreadedCode>(*prog) : nullptr;
+    }
+
+    // Configuration behind the transition the machine would take next, or
+    // nullptr if it has halted or has no transition for the scanned symbol.
+    const Configuration* nextConfiguration(){
+        if (currentState == Program::HALT_ID){return nullptr;}
+        return configTable[currentState * Program::NUM_SYMBOLS + tape.read()];
     }
 
     string sdifyQ(Configuration conf){
         stringstream ss;
         ss << 'D';
-        for (unsigned i = 0; i < conf.index; i++){
+        for (unsigned i = 0; i < sdNumberOf[conf.stateNo]; i++){
             ss << 'C';
         }
         return ss.str();
@@ -611,14 +2041,7 @@ class TM{
     string sdifyNC(Configuration conf){
         stringstream ss;
         ss << 'D';
-        int nextInd;
-        if (configIds.count(conf.nextConfig) == 0){
-            nextInd = configs.size();
-        }
-        else{
-            nextInd = configIds.at(conf.nextConfig);
-        }
-        for (unsigned i = 0; i < nextInd; i++){
+        for (unsigned i = 0; i < sdNumberOf[conf.nextNo]; i++){
             ss << 'C';
         }
         return ss.str();
@@ -639,7 +2062,7 @@ class TM{
     string sdifySig(Configuration conf){
         stringstream ss;
         ss << 'D';
-        for (unsigned i = 0; i < conf.index; i++){
+        for (unsigned i = 0; i < sdNumberOf[conf.stateNo]; i++){
             ss << 'C';
         }
         ss << 'D';
@@ -672,130 +2095,680 @@ class TM{
         cout << "  Initial tape state: " << tape.toString(20, 1) << endl;
 
         unsigned steps = 0;
+        const Program& prog = *program;
 
-        while (currentState != "HALT" && tape.getSize() < sizeLimit){
+        while (currentState != Program::HALT_ID && tape.getSize() < sizeLimit){
             cout << tape.toString(10, 1) << endl;
             Symbol currentSymbol = tape.read();
 
-            Configuration configuration = head.at(currentState).at(currentSymbol);
+            const Program::Transition& transition = prog.at(currentState, currentSymbol);
+            if (transition.next == Program::UNDEFINED_ID){
+                cout << "No transition for " << prog.nameOf(currentState) << "{'" << toStr.at(currentSymbol) << "'}" << endl;
+                break;
+            }
             
-            tape.write(configuration.writeSymbol);
+            tape.write((Symbol)transition.write);
 
-            if (configuration.direction == LEFT){
+            if (transition.move == LEFT){
                 tape.left();
             }
-            else if (configuration.direction == RIGHT){
+            else if (transition.move == RIGHT){
                 tape.right();
             }
 
-            currentState = configuration.nextConfig;
+            currentState = transition.next;
             steps++;
         }
         cout << "Halting...Steps taken: " << steps << endl;
     }
 
+    // Runs at full speed with no per-step output; see execute().
+    RunResult runHeadless(uint64_t maxSteps, bool sweeps = true){
+        if (engine == Engine::Threaded){
+            return threaded->run(tape, currentState, maxSteps, sizeLimit);
+        }
+        return execute(*program, tape, currentState, maxSteps, sizeLimit, sweeps);
+    }
+
+    // Switches the tape to the narrowest packed width the program's
+    // alphabet allows; returns bits per cell.
+    unsigned packTape(){
+        return tape.pack(program->alphabet());
+    }
+
+    // Selecting Threaded pre-decodes the program into threaded code.
+    void setEngine(Engine e){
+        engine = e;
+        if (engine == Engine::Threaded && !threaded && program){
+            threaded = std::make_shared<const ThreadedCode>(*program);
+        }
+    }
+
+    Engine getEngine() const {
+        return engine;
+    }
+
+    std::shared_ptr<const Program> getProgram() const {
+        return program;
+    }
+
+    uint32_t getState() const {
+        return currentState;
+    }
+
+    // for engines that run a program outside of TM, see macroMachine.hpp
+    void setState(uint32_t state){
+        currentState = state;
+    }
+
+    // Standard description of every transition, in definition order,
+    // spelled out the first time it's asked for. State number 0 (a bare D)
+    // is HALT; state k is the k-th state in order of first definition, and
+    // states that are only ever jumped to come after those, so k is the
+    // state's ID + 1.
+    const string& getFullSD(){
+        for (; sdWritten < configurations.size(); sdWritten++){
+            const Configuration& c = configurations[sdWritten];
+            fullSD += 'D';
+            fullSD.append(sdNumberOf[c.stateNo], 'C');
+            fullSD += 'D';
+            fullSD.append(symInd.at(c.readSymbol), 'A');
+            fullSD += 'D';
+            fullSD.append(symInd.at(c.writeSymbol), 'A');
+            fullSD += c.direction == RIGHT ? 'R' : c.direction == LEFT ? 'L' : 'N';
+            fullSD += 'D';
+            fullSD.append(sdNumberOf[c.nextNo], 'C');
+        }
+        return fullSD;
+    }
+
+    string currentStateName() const {
+        return program->nameOf(currentState);
+    }
+
     void runStepwise(int step){
         unsigned steps = 0;
+        collectSignatures();
        
-        while (currentState != "HALT" && tape.getSize() < sizeLimit){
+        while (currentState != Program::HALT_ID && tape.getSize() < sizeLimit){
             
-            Symbol currentSymbol = tape.read();
-
-            Configuration configuration = head.at(currentState).at(currentSymbol);
+            const Configuration* configuration = nextConfiguration();
+            if (configuration == nullptr){
+                cout << "No transition for " << program->nameOf(currentState) << "{'" << tape.readStr() << "'}" << endl;
+                break;
+            }
+            const Program::Transition& transition = program->at(currentState, configuration->readSymbol);
 
             if(steps % step == 0){
-                cout << "@ " << steps << ": SIGNATURE = " << configuration.signature << endl;
+                cout << "@ " << steps << ": SIGNATURE = " << configuration->signature << endl;
                 cout << tape.toString(10, 1) << endl << endl;
                 cin.get();
             }
             
-            tape.write(configuration.writeSymbol);
+            tape.write((Symbol)transition.write);
 
-            if (configuration.direction == LEFT){
+            if (transition.move == LEFT){
                 tape.left();
             }
-            else if (configuration.direction == RIGHT){
+            else if (transition.move == RIGHT){
                 tape.right();
             }
 
-            currentState = configuration.nextConfig;
+            currentState = transition.next;
             steps++;
         }
         cout << "Halting...Steps taken: " << steps << endl;
     }
 
+    // Runs the machine on its own thread while the window shows it at
+    // display rate. The speed slider goes from a step every two seconds,
+    // animated, to the machine running flat out; pauze, the time a step
+    // takes in milliseconds (0 for flat out), is where it starts.
     void runStepWiseWindow(unsigned pauze = 99, unsigned wWidth = 1503, unsigned wHeight = 810){
-        // turing steps completed
-        unsigned steps = 0;
-        // total steps (for animation)
-        int animator = 0;
-        // animation steps per turing step!
-        int animatorLoop = 81;
-        animatorLoop = std::min(animatorLoop, (int)pauze);
+        const double frameMillis = 1000.0 / 60;
         // window
         graphics::Window window(wWidth, wHeight, "Turing Machine Visualization");
         initializeColors((int)(window.getWidth()));
         window.clear();
+        indexShades();
 
         unsigned midX = window.getWidth()/2;
-        unsigned midY = window.getHeight()/2;
         unsigned tapeY = window.getHeight()/2;
-        unsigned squareWid = wHeight/10;
-        unsigned squareHi = squareWid;
+        unsigned squareHi = window.getHeight()/10;
         float scannedSquareMult = 1.25;
 
-        while (currentState != "HALT" && tape.getSize() < sizeLimit && window.isOpen()){
-            // where are we?
-            Symbol currentSymbol = tape.read();
-            Configuration configuration = head.at(currentState).at(currentSymbol);
+        // the genome bar only changes with the machine
+        window.beginGroup(GENOME_GROUP);
+        vizGenome(window);
+        window.endGroup();
+
+        sliderValue = pauze == 0 ? SLIDER_MAX : sliderFor(1000.0 / pauze);
+        draggingSlider = false;
+        std::atomic<double> rate{stepsPerSecond()};
+        bool sliderMoved = true;
+
+        // the simulation steps its own copy of the tape; this one is the
+        // window's, brought up to date from the snapshots
+        Tape work(tape);
+        SnapshotRing ring;
+        std::atomic<bool> stop{false};
+        std::thread simulation(&TM::simulate, this, std::ref(work), currentState, std::ref(ring), std::cref(stop), std::cref(rate));
+
+        // turing steps shown
+        uint64_t steps = 0;
+        // a Turing step happened since the last frame, and the cells it changed
+        bool stepped = true;
+        bool overviewMoved = false;
+        vector<int64_t> changedCells;
+        auto lastStep = std::chrono::steady_clock::now();
+        auto nextFrame = lastStep;
+        bool finished = false;
+
+        while (!finished){
+            for (StepSnapshot* snap; (snap = ring.front()) != nullptr; ring.pop()){
+                for (const DirtyCell& d : snap->cells){
+                    writeCell(d.cell, d.symbol, d.stain);
+                    changedCells.push_back(d.cell);
+                }
+                snap->cells.clear();
+                tape.reach(snap->leftEdge, snap->rightEdge);
+                tape.moveTo(snap->head);
+                currentState = snap->state;
+                if (snap->steps != steps){
+                    steps = snap->steps;
+                    stepped = true;
+                    lastStep = std::chrono::steady_clock::now();
+                }
+                finished = finished || snap->last;
+            }
+            if (!window.isOpen()){
+                // nothing left to draw, just wait for the last snapshot
+                stop.store(true, std::memory_order_relaxed);
+                graphics::pause(1);
+                continue;
+            }
 
-            // VIZ
+            while (window.hasEvents()){
+                graphics::Event e = window.getEvent();
+                if (handleSliderEvent(window, e)){
+                    rate.store(stepsPerSecond(), std::memory_order_relaxed);
+                    sliderMoved = true;
+                }
+                else if (handleOverviewEvent(window, e)){
+                    overviewMoved = true;
+                }
+            }
+
+            // VIZ: only what changed is drawn again
             ///////////////////////////////////////////////////////////////////////////////////////////////////////
-            window.clear();
-            vizTape(window, midX, tapeY, tape.getHead(), configuration, squareWid, squareHi, scannedSquareMult);
-            vizRunStats(window, steps, tape.getHead(), midX);
-            vizGenome(window, configuration.signature, sdifySig(configuration));
-            vizWholeTape(window, sigToColor.at(configuration.signature));
-            if (animator % animatorLoop != 0){
-                vizBinding(window, configuration, midX, tapeY - (scannedSquareMult*squareHi*0.5) - window.getHeight() * 0.0175, window.getHeight() * 0.0125,((animator%animatorLoop)/((double)animatorLoop)), 0.54);
+            if (sliderMoved){
+                window.beginGroup(SLIDER_GROUP);
+                vizSlider(window);
+                window.endGroup();
+                sliderMoved = false;
+            }
+            const Configuration* next = nextConfiguration();
+            if (next != nullptr){
+                const Configuration& configuration = *next;
+                if (stepped || overviewMoved){
+                    vizStep(window, configuration, steps, changedCells);
+                    stepped = false;
+                    overviewMoved = false;
+                }
+                // the binding slides into place while a step lasts two frames
+                // or more; faster than that it would only flicker
+                window.beginGroup(BINDING_GROUP);
+                double perStep = 1000.0 / rate.load(std::memory_order_relaxed);
+                if (perStep >= 2 * frameMillis && !finished){
+                    double sinceStep = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - lastStep).count();
+                    vizBinding(window, configuration, midX, tapeY - (scannedSquareMult*squareHi*0.5) - window.getHeight() * 0.0175, window.getHeight() * 0.0125, std::min(1.0, sinceStep / perStep), 0.54);
+                }
+                window.endGroup();
             }
             window.update();
             ///////////////////////////////////////////////////////////////////////////////////////////////////////
 
-            // actual turing loop
-            if(animator % animatorLoop == 0){
-                // full pause
-                graphics::pause(pauze);
-                // write new sym
-                tape.write(configuration.writeSymbol);
-                // if we're operating on a white cell, add it to seen cells
-                if (tape.cellColors[tape.getHead()] == graphics::WHITE){
-                    tape.cellsInUse++;
-                }
-                // update config stain regardless
-                tape.cellColors[tape.getHead()] = sigToColor.at(configuration.signature);
-                
-                // move
-                if (configuration.direction == LEFT){
-                    tape.left();
-                }
-                else if (configuration.direction == RIGHT){
-                    tape.right();
-                }
-                // update state
-                currentState = configuration.nextConfig;
+            // frames keep to the clock; a late one is followed straight away
+            // by the next rather than making up for lost time
+            nextFrame += std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double, std::milli>(frameMillis));
+            auto now = std::chrono::steady_clock::now();
+            if (nextFrame < now){
+                nextFrame = now;
+            }
+            else if (!finished){
+                std::this_thread::sleep_until(nextFrame);
+            }
+        }
+        simulation.join();
+    }
+
+    // Renders the run to window without pausing, a frame every
+    // stepsPerFrame steps and one at the end, for windows that draw
+    // offscreen (see Window::recordFrames). Stops after maxFrames frames if
+    // the machine hasn't halted by then. Returns the steps taken.
+    uint64_t renderFrames(graphics::Window& window, uint64_t stepsPerFrame, uint64_t maxFrames){
+        initializeColors((int)(window.getWidth()));
+        window.clear();
+        indexShades();
+        window.beginGroup(GENOME_GROUP);
+        vizGenome(window);
+        window.endGroup();
+
+        const Program& prog = *program;
+        vector<Tape::Stain> stainOf = transitionStains();
+
+        uint64_t steps = 0;
+        vector<int64_t> changedCells;
+        bool running = true;
+        for (uint64_t frame = 0; frame < maxFrames && running; frame++){
+            if (frame > 0){
+                for (uint64_t i = 0; i < stepsPerFrame; i++){
+                    if (currentState == Program::HALT_ID || tape.getSize() >= sizeLimit){
+                        running = false;
+                        break;
+                    }
+                    size_t slot = currentState * Program::NUM_SYMBOLS + tape.read();
+                    const Program::Transition& t = prog.table[slot];
+                    if (t.next == Program::UNDEFINED_ID){
+                        running = false;
+                        break;
+                    }
+                    writeCell(tape.getHead(), (Symbol)t.write, stainOf[slot]);
+                    changedCells.push_back(tape.getHead());
+                    if (t.move == LEFT){
+                        tape.left();
+                    }
+                    else if (t.move == RIGHT){
+                        tape.right();
+                    }
+                    currentState = t.next;
+                    steps++;
+                }
+            }
+            const Configuration* next = nextConfiguration();
+            if (next != nullptr){
+                vizStep(window, *next, steps, changedCells);
+            }
+            window.update();
+        }
+        return steps;
+    }
+
+    // Draws the parts of the window that change with each step: the tape
+    // around the head, the run stats, the current gene and changedCells on
+    // the whole tape, which it empties.
+    void vizStep(graphics::Window& window, const Configuration& configuration, uint64_t steps, vector<int64_t>& changedCells){
+        unsigned midX = window.getWidth()/2;
+        unsigned tapeY = window.getHeight()/2;
+        unsigned squareWid = window.getHeight()/10;
+        window.beginGroup(TAPE_GROUP);
+        vizTape(window, midX, tapeY, tape.getHead(), configuration, squareWid, squareWid, 1.25);
+        window.endGroup();
+        window.beginGroup(STATS_GROUP);
+        vizRunStats(window, steps, tape.getHead(), midX);
+        window.endGroup();
+        window.beginGroup(GENE_GROUP);
+        vizGene(window, configuration.signature, sdifySig(configuration));
+        window.endGroup();
+        // a cell written many times since the last frame is drawn once
+        std::sort(changedCells.begin(), changedCells.end());
+        changedCells.erase(std::unique(changedCells.begin(), changedCells.end()), changedCells.end());
+        vizWholeTape(window, sigToColor.at(configuration.signature), changedCells);
+        changedCells.clear();
+    }
+
+    // How a space-time diagram colors cells: by the Symbol in them, or by
+    // the stain of the configuration that last wrote them.
+    enum class SpaceTimeColors{
+        BySymbol,
+        ByStain
+    };
+
+    // Writes the run's space-time diagram of cells [first, first + width)
+    // to an image file (see graphics::ImageWriter): a row for the tape as
+    // it is, then one every stepsPerRow steps, maxRows at most, each cell
+    // scale pixels square. Rows are written as they are made, so the image
+    // is only limited by the disk. Returns the steps taken.
+    uint64_t exportSpaceTime(const string& path, uint64_t maxRows, uint64_t stepsPerRow, SpaceTimeColors colors,
+                             int64_t first, unsigned width, unsigned scale = 1){
+        initializeColors(width);
+        SpaceTimeDiagram diagram(first, width, scale, scale);
+        setSpaceTimePalette(diagram, colors);
+        vector<Tape::Stain> stainOf = transitionStains();
+        vector<uint8_t> cells(width);
+        vector<Tape::Stain> stains(width);
+        graphics::ImageWriter image(path, width * diagram.getScale());
+
+        uint64_t steps = 0;
+        for (uint64_t row = 0; row < maxRows; row++){
+            if (row > 0){
+                uint64_t before = steps;
+                stepSpaceTime(stepsPerRow, steps, stainOf);
+                if (steps == before){
+                    break;
+                }
+            }
+            const uint8_t* pixels = addSpaceTimeRow(diagram, colors, cells, stains);
+            for (unsigned k = 0; k < diagram.getScale(); k++){
+                image.writeRow(pixels);
+            }
+        }
+        image.close();
+        return steps;
+    }
+
+    // Runs the machine under a space-time diagram that scrolls up the
+    // window, newest row at the bottom: a row every stepsPerRow steps, of
+    // the cells around where the head starts, each scale pixels square.
+    // Steps as fast as drawing at 60 frames a second allows and returns
+    // once the window is closed; on the software backend, where nothing
+    // records this window, that is straight away (see exportSpaceTime()).
+    void runSpaceTimeWindow(uint64_t stepsPerRow = 1, SpaceTimeColors colors = SpaceTimeColors::ByStain,
+                            unsigned scale = 2, unsigned wWidth = 1503, unsigned wHeight = 810){
+        const double frameMillis = 1000.0 / 60;
+        graphics::Window window(wWidth, wHeight, "Turing Machine Space-Time Diagram");
+        window.clear();
+        scale = std::max(scale, 1u);
+        unsigned width = window.getWidth() / scale;
+        unsigned statsHeight = window.getHeight() * 0.05;
+        unsigned history = window.getHeight() - statsHeight;
+        int64_t first = tape.getHead() - width / 2;
+        initializeColors(width);
+        SpaceTimeDiagram diagram(first, width, history, scale);
+        setSpaceTimePalette(diagram, colors);
+        vector<Tape::Stain> stainOf = transitionStains();
+        vector<uint8_t> cells(width);
+        vector<Tape::Stain> stains(width);
+        addSpaceTimeRow(diagram, colors, cells, stains);
+
+        vector<uint8_t> image;
+        uint64_t steps = 0;
+        uint64_t rows = 1;
+        bool running = true;
+        bool changed = true;
+        auto nextFrame = std::chrono::steady_clock::now();
+        while (window.isOpen()){
+            while (window.hasEvents()){
+                window.getEvent();
+            }
+            nextFrame += std::chrono::microseconds((int64_t)(frameMillis * 1000));
+            // most of the frame goes to stepping, the rest to drawing
+            auto until = nextFrame - std::chrono::microseconds((int64_t)(frameMillis * 250));
+            while (running && std::chrono::steady_clock::now() < until){
+                uint64_t before = steps;
+                running = stepSpaceTime(stepsPerRow, steps, stainOf) && steps > before;
+                if (steps > before){
+                    addSpaceTimeRow(diagram, colors, cells, stains);
+                    rows++;
+                    changed = true;
+                }
+            }
+            if (changed){
+                diagram.copyRows(image);
+                window.beginGroup(SPACE_TIME_GROUP);
+                window.drawImage(image.data(), 0, history - diagram.getRows(), width * scale, diagram.getRows());
+                window.endGroup();
+                stringstream ss;
+                ss << "Step #" << steps << ", row #" << rows << ", squares #" << first << " to #" << first + width - 1
+                   << (running ? "" : ", stopped in state " + currentStateName());
+                window.beginGroup(STATS_GROUP);
+                graphics::drawShapeWithText(window, ss.str(), window.getWidth() / 2, history + statsHeight / 2, window.getWidth(), statsHeight);
+                window.endGroup();
+                changed = false;
+            }
+            // every frame, so a recording runs on once the machine stops
+            window.update();
+            auto now = std::chrono::steady_clock::now();
+            if (nextFrame < now){
+                nextFrame = now;
+            }
+            std::this_thread::sleep_until(nextFrame);
+        }
+    }
+
+    // diagram's palette for colors; needs initializeColors()
+    void setSpaceTimePalette(SpaceTimeDiagram& diagram, SpaceTimeColors colors) const {
+        if (colors == SpaceTimeColors::ByStain){
+            diagram.setPalette(stainRgb);
+            return;
+        }
+        // as the binary view: blank white, 0 dark gray, 1 black
+        vector<SpaceTimeDiagram::Color> palette;
+        for (const string& color : {graphics::WHITE, graphics::DARK_GRAY, graphics::BLACK}){
+            palette.emplace_back();
+            graphics::hexToRgb(color, palette.back()[0], palette.back()[1], palette.back()[2]);
+        }
+        for (const string& color : generateColorSpectrum(Program::NUM_SYMBOLS - palette.size())){
+            palette.emplace_back();
+            graphics::hexToRgb(color, palette.back()[0], palette.back()[1], palette.back()[2]);
+        }
+        diagram.setPalette(palette);
+    }
+
+    // Up to n steps, staining the cells written with stainOf (see
+    // transitionStains()). False once the machine has halted, has no
+    // transition or has outgrown sizeLimit.
+    bool stepSpaceTime(uint64_t n, uint64_t& steps, const vector<Tape::Stain>& stainOf){
+        const Program& prog = *program;
+        for (uint64_t i = 0; i < n; i++){
+            if (currentState == Program::HALT_ID || tape.getSize() >= sizeLimit){
+                return false;
+            }
+            size_t slot = currentState * Program::NUM_SYMBOLS + tape.read();
+            const Program::Transition& t = prog.table[slot];
+            if (t.next == Program::UNDEFINED_ID){
+                return false;
+            }
+            tape.write((Symbol)t.write);
+            tape.stain(tape.getHead(), stainOf[slot]);
+            if (t.move == LEFT){
+                tape.left();
+            }
+            else if (t.move == RIGHT){
+                tape.right();
+            }
+            currentState = t.next;
+            steps++;
+        }
+        return true;
+    }
+
+    // Adds the tape as it is to diagram; cells and stains are scratch
+    // space for a row.
+    const uint8_t* addSpaceTimeRow(SpaceTimeDiagram& diagram, SpaceTimeColors colors, vector<uint8_t>& cells, vector<Tape::Stain>& stains){
+        if (colors == SpaceTimeColors::ByStain){
+            tape.stainsIn(diagram.getFirst(), diagram.getWidth(), stains.data());
+            return diagram.addRow(stains.data());
+        }
+        tape.unpack(diagram.getFirst(), diagram.getWidth(), cells.data());
+        return diagram.addRow(cells.data());
+    }
+
+    // Speed for a slider position: exponential, from half a step a second
+    // at 0 to flat out (infinity) at SLIDER_MAX.
+    double stepsPerSecond() const {
+        if (sliderValue >= SLIDER_MAX){
+            return INFINITY;
+        }
+        return 0.5 * std::pow(10.0, 9.0 * sliderValue / SLIDER_MAX);
+    }
+
+    static int sliderFor(double stepsPerSecond){
+        double v = std::log10(stepsPerSecond / 0.5) * SLIDER_MAX / 9.0;
+        return (int)std::min<double>(SLIDER_MAX, std::max(0.0, std::round(v)));
+    }
+
+    // where the slider's track is drawn: x from, x to, y
+    void sliderTrack(const graphics::Window& window, int& x0, int& x1, int& y) const {
+        x0 = window.getWidth() * 0.3;
+        x1 = window.getWidth() * 0.7;
+        y = window.getHeight() * 0.7;
+    }
+
+    // Drags the slider with the left mouse button; true if it moved.
+    bool handleSliderEvent(const graphics::Window& window, const graphics::Event& e){
+        int x0, x1, y;
+        sliderTrack(window, x0, x1, y);
+        if (e.Type == graphics::EventType::MouseBtnDown && e.Event.Mouse.Button == graphics::MouseButton::Left){
+            draggingSlider = e.Event.Mouse.X >= x0 - 10 && e.Event.Mouse.X <= x1 + 10 && std::abs(e.Event.Mouse.Y - y) <= 12;
+        }
+        else if (e.Type == graphics::EventType::MouseBtnUp){
+            draggingSlider = false;
+            return false;
+        }
+        else if (e.Type != graphics::EventType::MouseDrag){
+            return false;
+        }
+        if (!draggingSlider){
+            return false;
+        }
+        int value = std::min(SLIDER_MAX, std::max(0, (int)((e.Event.Mouse.X - x0) * (double)SLIDER_MAX / (x1 - x0))));
+        if (value == sliderValue){
+            return false;
+        }
+        sliderValue = value;
+        return true;
+    }
+
+    void vizSlider(graphics::Window& window){
+        int x0, x1, y;
+        sliderTrack(window, x0, x1, y);
+        window.setColor(graphics::LIGHT_GRAY);
+        window.fillRect(x0, y - 2, x1 - x0, 4);
+        int knobX = x0 + (x1 - x0) * (double)sliderValue / SLIDER_MAX;
+        window.setColor(draggingSlider ? graphics::GRAY : graphics::DARK_GRAY);
+        window.fillRect(knobX - 5, y - 10, 10, 20);
+
+        stringstream ss;
+        double speed = stepsPerSecond();
+        if (std::isinf(speed)){
+            ss << "Speed: flat out ";
+        }
+        else if (speed < 10){
+            ss << "Speed: " << std::fixed << std::setprecision(1) << speed << " steps/s ";
+        }
+        else{
+            // 3 significant figures with a k/M/G suffix
+            const char* suffixes[] = {"", "k", "M", "G"};
+            unsigned i = 0;
+            while (speed >= 1000 && i < 3){
+                speed /= 1000;
+                i++;
+            }
+            ss << "Speed: " << std::setprecision(3) << speed << suffixes[i] << " steps/s ";
+        }
+        graphics::drawShapeAroundText(window, ss.str(), x0 - graphics::widthOfTextBox(ss.str(), 3) / 2 - 15, y, window.getHeight() * 0.035, graphics::WHITE, 3);
+    }
+
+    // The simulation thread of runStepWiseWindow: steps work from state
+    // until the machine halts, has no transition, outgrows sizeLimit or
+    // stop is set, publishing snapshots to ring as it goes. rate, in steps
+    // a second, is kept to by the clock and may change at any time. It
+    // never waits for the window: while the ring is full it keeps the cells
+    // it wrote and publishes them with a later snapshot.
+    void simulate(Tape& work, uint32_t state, SnapshotRing& ring, const std::atomic<bool>& stop, const std::atomic<double>& rate){
+        const Program& prog = *program;
+        vector<Tape::Stain> stainOf = transitionStains();
+
+        typedef std::chrono::steady_clock Clock;
+        // most steps between looks at the clock, and the time between snapshots
+        const uint64_t batch = 4096;
+        const auto publishEvery = std::chrono::milliseconds(2);
+        vector<DirtyCell> dirty;
+        size_t compactAt = 1 << 16;
+        uint64_t steps = 0;
+        uint64_t published = ~0ull;
+        bool running = true;
+        auto lastPublish = Clock::now() - publishEvery;
+        // steps are due at speed steps a second from epoch, when epochSteps had been taken
+        double speed = rate.load(std::memory_order_relaxed);
+        auto epoch = Clock::now();
+        uint64_t epochSteps = 0;
+        while (true){
+            auto now = Clock::now();
+            if (rate.load(std::memory_order_relaxed) != speed){
+                speed = rate.load(std::memory_order_relaxed);
+                epoch = now;
+                epochSteps = steps;
+            }
+            uint64_t due = batch;
+            if (!std::isinf(speed)){
+                double owed = std::chrono::duration<double>(now - epoch).count() * speed + 1 - (steps - epochSteps);
+                due = std::min<double>(batch, std::max(0.0, owed));
+            }
+
+            for (uint64_t i = 0; i < due && running; i++){
+                if (state == Program::HALT_ID || work.getSize() >= sizeLimit){
+                    running = false;
+                    break;
+                }
+                size_t slot = state * Program::NUM_SYMBOLS + work.read();
+                const Program::Transition& t = prog.table[slot];
+                if (t.next == Program::UNDEFINED_ID){
+                    running = false;
+                    break;
+                }
+                work.write((Symbol)t.write);
+                dirty.push_back({work.getHead(), (Symbol)t.write, stainOf[slot]});
+                if (t.move == LEFT){
+                    work.left();
+                }
+                else if (t.move == RIGHT){
+                    work.right();
+                }
+                state = t.next;
                 steps++;
             }
-            // non turing loop, just animation
-            else{
-                graphics::pause(pauze/animatorLoop);
+            running = running && !stop.load(std::memory_order_relaxed);
+
+            now = Clock::now();
+            bool publish = !running || (steps != published && now - lastPublish >= publishEvery);
+            StepSnapshot* snap = publish ? ring.claim() : nullptr;
+            if (snap != nullptr){
+                snap->steps = steps;
+                snap->state = state;
+                snap->head = work.getHead();
+                snap->leftEdge = work.getLeftEdge();
+                snap->rightEdge = work.getRightEdge();
+                std::swap(snap->cells, dirty);
+                snap->last = !running;
+                ring.publish();
+                published = steps;
+                lastPublish = now;
+                if (!running){
+                    return;
+                }
+            }
+            else if (!running){
+                // the last snapshot has to get through
+                std::this_thread::yield();
+            }
+            else if (dirty.size() >= compactAt){
+                // only the last write to each cell matters
+                std::stable_sort(dirty.begin(), dirty.end(), [](const DirtyCell& a, const DirtyCell& b){
+                    return a.cell < b.cell;
+                });
+                size_t kept = 0;
+                for (size_t i = 0; i < dirty.size(); i++){
+                    if (i + 1 == dirty.size() || dirty[i + 1].cell != dirty[i].cell){
+                        dirty[kept++] = dirty[i];
+                    }
+                }
+                dirty.resize(kept);
+                compactAt = std::max<size_t>(compactAt, 2 * kept);
+            }
+
+            if (due == 0 && running){
+                // nothing due yet: sleep until the next step, but not past
+                // a change of speed by much
+                double wait = (steps - epochSteps - std::chrono::duration<double>(now - epoch).count() * speed) / speed;
+                std::this_thread::sleep_for(std::chrono::duration<double>(std::min(std::max(wait, 0.0), 0.005)));
             }
-            animator++;
         }
     }
 
     void vizTape(graphics::Window& window, unsigned x, unsigned y, 
-                 unsigned squarePos, Configuration config, unsigned 
+                 int64_t squarePos, Configuration config, unsigned 
                  sqWid, unsigned sqHi, float mult)
     {
         // squares on either side
@@ -803,11 +2776,12 @@ class TM{
 
         // current square
         graphics::drawShapeWithText(window, tape.readStr(), x, y, sqWid*mult, sqHi*mult, true, 
-                            tape.cellColors.at(squarePos));
+                            stainColor(squarePos));
 
         // head      
-        int sigWid = graphics::widthOfTextBox(config.sdSig, 3);
-        graphics::drawShapeAroundText(window, config.sdSig, 
+        string sdSig = sdifySig(config);
+        int sigWid = graphics::widthOfTextBox(sdSig, 3);
+        graphics::drawShapeAroundText(window, sdSig, 
             // y: - scann sq height - half my own height
             x, y - (mult*sqHi*0.5) - window.getHeight() * 0.0175, window.getHeight() * 0.035, sigToColor.at(config.signature), 3);
         
@@ -824,45 +2798,63 @@ class TM{
         // edges
         stringstream rs;
         stringstream ls;
-        rs << "   ... << [" << tape.getHead() - 1 << "]...";
-        ls << "   ...[" <<tape.getSize() - tape.getHead() << "] >> ...";
+        rs << "   ... << [" << tape.getHead() - tape.getLeftEdge() << "]...";
+        ls << "   ...[" << tape.getRightEdge() - tape.getHead() << "] >> ...";
 
         for (unsigned i = 0; i <= flank; i++){
             if (i!= flank){
                 // actual squares, i to the right and left
                 graphics::drawShapeWithText(window, tape.readStr(-i), 
                     x-((int)(sqWid*mult))-(sqWid*(std::max(0, int(i-1)))), 
-                y, sqWid, sqHi, true, tape.cellColors.at(std::max((int)(squarePos - i), 0)));
+                y, sqWid, sqHi, true, stainColor(std::max(squarePos - i, tape.getLeftEdge())));
 
                 graphics::drawShapeWithText(window, tape.readStr(i), 
                     x+((int)(sqWid*mult))+(sqWid*(std::max(0, int(i-1)))), 
-                y, sqWid, sqHi, true,tape.cellColors.at(std::min(squarePos + i, tape.getSize()-1)));
+                y, sqWid, sqHi, true, stainColor(std::min(squarePos + i, tape.getRightEdge())));
                 }
             else{
                 // side messages
                 graphics::drawShapeWithText(window, rs.str(), 
                     sqWid,
-                y, sqWid*2, sqHi, true, tape.cellColors.at(std::max((int)(squarePos - i), 0)));
+                y, sqWid*2, sqHi, true, stainColor(std::max(squarePos - i, tape.getLeftEdge())));
 
                 graphics::drawShapeWithText(window, ls.str(), 
                     window.getWidth() - sqWid,
-                y, sqWid*2, sqWid, true, tape.cellColors.at(std::min(squarePos + i, tape.getSize()-1)));
+                y, sqWid*2, sqWid, true, stainColor(std::min(squarePos + i, tape.getRightEdge())));
             }
         }
 
     }
 
-    void vizRunStats(graphics::Window& window, int numIters, int sqarePos, unsigned midX){
+    void vizRunStats(graphics::Window& window, uint64_t numIters, int64_t sqarePos, unsigned midX){
         stringstream ss;
         ss << "Iteration #" << numIters << ", on sqaure #" << sqarePos;
         graphics::drawShapeWithText(window, ss.str(), midX, window.getHeight() * 0.975, window.getWidth(), window.getHeight() * 0.05);
     }
 
     void initializeColors(unsigned width) {
+        collectSignatures();
         std::vector<std::string> colors = generateColorSpectrum(signatures.size());
         
+        // configurations sharing a color share a stain; the spectrum has a
+        // few thousand colors at most, however many configurations
+        stainColors.assign(1, graphics::WHITE);
+        signatureStains.assign(signatures.size(), Tape::UNSTAINED);
+        unordered_map<string, Tape::Stain> stainOfColor;
         for (size_t i = 0; i < signatures.size(); i++) {
             sigToColor[signatures[i]] = colors[i];
+            auto [it, fresh] = stainOfColor.try_emplace(colors[i], (Tape::Stain)stainColors.size());
+            if (fresh) {
+                if (stainColors.size() > std::numeric_limits<Tape::Stain>::max()) {
+                    throw std::length_error("Too many colors to stain the tape with");
+                }
+                stainColors.push_back(colors[i]);
+            }
+            signatureStains[i] = it->second;
+        }
+        stainRgb.resize(stainColors.size());
+        for (size_t i = 0; i < stainColors.size(); i++) {
+            graphics::hexToRgb(stainColors[i], stainRgb[i][0], stainRgb[i][1], stainRgb[i][2]);
         }
         
         int configWidth = width / signatures.size();
@@ -872,20 +2864,21 @@ class TM{
         }
     }
 
-    void vizGenome(graphics::Window& window, const string& currSig, const string& currGene){
+    void vizGenome(graphics::Window& window){
         stringstream ss;
-        ss << "Turing Machine Genome: " << configs.size()-1 << " genes, " << fullSD.size() << " total nucleotides!";
+        ss << "Turing Machine Genome: " << configCount-1 << " genes, " << getFullSD().size() << " total nucleotides!";
         graphics::drawShapeWithText(window, ss.str(), window.getWidth()/2, window.getHeight() * 0.0125, window.getWidth(), window.getHeight() * 0.025);
         int widdy = (int) window.getWidth()/signatures.size();
         for (string s : signatures){
             graphics::drawShapeWithText(window, "Q" + std::to_string(1+signatureToCongifIndex.at(s)), scaleToGene.at(sigToScale.at(s)), window.getHeight() * 0.0425, widdy, window.getHeight() * 0.035, true, sigToColor.at(s));
-            if (s == currSig){
-                // SD
-                graphics::drawShapeAroundText(window, currGene, scaleToGene.at(sigToScale.at(s)), window.getHeight() * 0.0775, window.getHeight() * 0.035, sigToColor.at(s), 2);
-            }   
         }
     }
 
+    // the current gene's SD, under its slot in the genome
+    void vizGene(graphics::Window& window, const string& currSig, const string& currGene){
+        graphics::drawShapeAroundText(window, currGene, scaleToGene.at(sigToScale.at(currSig)), window.getHeight() * 0.0775, window.getHeight() * 0.035, sigToColor.at(currSig), 2);
+    }
+
     void vizBinding(graphics::Window& window, const Configuration& config, unsigned midX, unsigned toY, int fromY, double iterPercent, float movePercent){
         // human signature
         string currSig = config.signature;
@@ -956,45 +2949,256 @@ class TM{
         graphics::drawShapeAroundText(window, sdifyNC(config), xAx, yAx, window.getHeight() * 0.035, sigToColor.at(currSig), 6, 14, false);
     }
 
-    void vizWholeTape(graphics::Window& window, const string& headColor){
-        int wid = (int)(window.getWidth()/tape.cellsInUse);
+    // the stain each transition slot writes, laid out like program->table
+    vector<Tape::Stain> transitionStains() const {
+        vector<Tape::Stain> stainOf(program->table.size(), Tape::UNSTAINED);
+        for (size_t i = 0; i < configTable.size(); i++){
+            if (configTable[i] != nullptr){
+                stainOf[i] = signatureStains[sigToScale.at(configTable[i]->signature)];
+            }
+        }
+        return stainOf;
+    }
+
+    const string& stainColor(int64_t i) const {
+        Tape::Stain stain = tape.stainAt(i);
+        return stain < stainColors.size() ? stainColors[stain] : graphics::WHITE;
+    }
+
+    // A cell's colors in the whole-tape overview: its stain, then its
+    // binary view (S0 dark gray, S1 black, anything else its stain dulled).
+    ShadeSums::Sums shadeOf(Symbol cell, Tape::Stain stain) const {
+        static const SpaceTimeDiagram::Color white = {255, 255, 255};
+        const SpaceTimeDiagram::Color& c = stain < stainRgb.size() ? stainRgb[stain] : white;
+        int r = c[0], g = c[1], b = c[2];
+        if (cell == S0){
+            return {r, g, b, 0x55, 0x55, 0x55};
+        }
+        if (cell == S1){
+            return {r, g, b, 0, 0, 0};
+        }
+        // as dullerColor()
+        return {r, g, b, (int)(r + (255 - r) * 0.91), (int)(g + (255 - g) * 0.91), (int)(b + (255 - b) * 0.91)};
+    }
+
+    static ShadeSums::Sums difference(const ShadeSums::Sums& a, const ShadeSums::Sums& b){
+        ShadeSums::Sums d;
+        for (size_t k = 0; k < d.size(); k++){
+            d[k] = a[k] - b[k];
+        }
+        return d;
+    }
+
+    // Writes and stains cell i, keeping tapeShades up to date.
+    void writeCell(int64_t i, Symbol symbol, Tape::Stain stain){
+        ShadeSums::Sums before = shadeOf(tape.readAt(i), tape.stainAt(i));
+        tape.writeAt(i, symbol);
+        tape.stain(i, stain);
+        ShadeSums::Sums after = shadeOf(symbol, stain);
+        if (after != before){
+            tapeShades.add(i, difference(after, before));
+        }
+    }
+
+    // Builds tapeShades from the tape as it is.
+    void indexShades(){
+        tapeShades.clear();
+        blankShade = shadeOf(tape.getFill(), Tape::UNSTAINED);
+        overviewColumns.clear();
+        vector<uint8_t> cells(Tape::CHUNK_CELLS);
+        vector<Tape::Stain> stains(Tape::CHUNK_CELLS);
+        for (int64_t from = tape.getLeftEdge(); from <= tape.getRightEdge(); from += cells.size()){
+            size_t n = std::min<int64_t>(cells.size(), tape.getRightEdge() - from + 1);
+            tape.unpack(from, n, cells.data());
+            tape.stainsIn(from, n, stains.data());
+            for (size_t j = 0; j < n; j++){
+                if (cells[j] != tape.getFill() || stains[j] != Tape::UNSTAINED){
+                    tapeShades.add(from + j, difference(shadeOf((Symbol)cells[j], stains[j]), blankShade));
+                }
+            }
+        }
+    }
+
+    // Shows cells [first, first + cells) in the overview from now on, or
+    // the whole tape as it grows if cells is 0.
+    void setOverview(int64_t first, int64_t cells){
+        overview.fit = cells <= 0;
+        overview.first = first;
+        overview.cells = std::max<int64_t>(cells, 1);
+    }
+
+    // Zooms with + and - (about the middle), pans with the arrow keys or a
+    // drag across the overview, and fits the whole tape again with 0.
+    // True if the view changed.
+    bool handleOverviewEvent(const graphics::Window& window, const graphics::Event& e){
+        int64_t first = overview.fit ? tape.getLeftEdge() : overview.first;
+        int64_t cells = overview.fit ? (int64_t)tape.getSize() : overview.cells;
+        int top = window.getHeight() * 0.825;
+        int bottom = window.getHeight() * 0.925;
+        if (e.Type == graphics::EventType::MouseBtnDown){
+            panningOverview = e.Event.Mouse.Y >= top && e.Event.Mouse.Y < bottom;
+            panFromX = e.Event.Mouse.X;
+            panFromFirst = first;
+            return false;
+        }
+        if (e.Type == graphics::EventType::MouseBtnUp){
+            panningOverview = false;
+            return false;
+        }
+        if (e.Type == graphics::EventType::MouseDrag){
+            if (!panningOverview){
+                return false;
+            }
+            int64_t moved = (int64_t)((double)(panFromX - e.Event.Mouse.X) * cells / window.getWidth());
+            if (panFromFirst + moved == first){
+                return false;
+            }
+            setOverview(panFromFirst + moved, cells);
+            return true;
+        }
+        if (e.Type != graphics::EventType::KeyDown){
+            return false;
+        }
+        int key = e.Event.Key.Code;
+        if (key == '+' || key == '='){
+            // no closer than 8 cells across
+            int64_t zoomed = std::max<int64_t>(8, cells / 2);
+            setOverview(first + (cells - zoomed) / 2, zoomed);
+        }
+        else if (key == '-'){
+            setOverview(first - cells / 2, cells * 2);
+        }
+        else if (key == graphics::KeyCode::Left || key == graphics::KeyCode::Right){
+            int64_t by = std::max<int64_t>(1, cells / 4);
+            setOverview(key == graphics::KeyCode::Left ? first - by : first + by, cells);
+        }
+        else if (key == '0'){
+            setOverview(0, 0);
+        }
+        else{
+            return false;
+        }
+        return true;
+    }
+
+    // Column j's colors, stain << 24 | binary view, of columns columns
+    // over cells from first. Wide columns are summed over whole buckets of
+    // tapeShades, narrow ones a cell at a time.
+    uint64_t overviewColumn(int64_t first, int64_t cells, int columns, int j){
+        int64_t from = first + j * cells / columns;
+        int64_t to = first + (j + 1) * cells / columns;
+        ShadeSums::Sums sum{};
+        int64_t n;
+        if (to - from >= ShadeSums::BUCKET){
+            int64_t fromBucket = ShadeSums::bucketOf(from);
+            int64_t toBucket = ShadeSums::bucketOf(to);
+            sum = tapeShades.sum(fromBucket, toBucket);
+            n = (toBucket - fromBucket) * ShadeSums::BUCKET;
+        }
+        else{
+            for (int64_t i = from; i < to; i++){
+                ShadeSums::Sums shade = shadeOf(tape.readAt(i), tape.stainAt(i));
+                for (size_t k = 0; k < sum.size(); k++){
+                    sum[k] += shade[k] - blankShade[k];
+                }
+            }
+            n = to - from;
+        }
+        uint64_t packed = 0;
+        for (size_t k = 0; k < sum.size(); k++){
+            int64_t average = blankShade[k] + (sum[k] + (sum[k] >= 0 ? n / 2 : -n / 2)) / n;
+            packed = packed << 8 | (uint64_t)std::min<int64_t>(255, std::max<int64_t>(0, average));
+        }
+        return packed;
+    }
+
+    // Draws the head marker and the overview of the tape below it: a
+    // column per pixel (or per cell, if they're wider), each the average of
+    // its cells. Only columns whose colors changed are drawn again, so a
+    // frame costs at most the window's width in columns, however long the
+    // tape; changed is where the tape was written since the last frame.
+    void vizWholeTape(graphics::Window& window, const string& headColor, const vector<int64_t>& changed){
+        int width = window.getWidth();
+        int64_t first = overview.fit ? tape.getLeftEdge() : overview.first;
+        int64_t cells = overview.fit ? (int64_t)tape.getSize() : overview.cells;
+        int columns = (int)std::min<int64_t>(width, cells);
 
         // moving head:
-        string headthing;
-        int headX;
-        if (tape.getHead() < tape.cellsInUse) {
-            // Head is within the visible cells - show exact position
-            headthing = "HEAD ";
-            headX = (tape.getHead() + 0.5) * wid;
-        } else {
-            // Head is beyond visible cells - show arrow at right edge
+        string headthing = "HEAD ";
+        int headX = (tape.getHead() - first + 0.5) * width / cells;
+        if (tape.getHead() < first){
+            headthing = "<< HEAD ";
+            headX = 0;
+        }
+        else if (tape.getHead() >= first + cells){
             headthing = "HEAD >> ";
-            headX = window.getWidth() - wid/2.0;
+            headX = width;
         }
         // min size
-        int cappedWid = std::max(wid, (int)(12 * headthing.size()));
-        graphics::drawShapeWithText(window, headthing, headX, window.getHeight() * 0.8, cappedWid, window.getHeight() * 0.027, true, headColor);
-
-        for (unsigned i = 0; i < tape.cellsInUse; i++){
-            // config-stained view
-            window.setColor(tape.cellColors.at(i));
-            window.fillRect(i * wid, window.getHeight() * 0.825, wid, window.getHeight() * 0.05);
-            window.setColor(graphics::BLACK);
-            window.drawRect(i * wid, window.getHeight() * 0.825, wid, window.getHeight() * 0.05);
+        int boxWid = graphics::widthOfTextBox(headthing, 2);
+        headX = std::max(boxWid / 2, std::min(width - boxWid / 2, headX));
+        window.beginGroup(HEAD_GROUP);
+        graphics::drawShapeWithText(window, headthing, headX, window.getHeight() * 0.8, boxWid, window.getHeight() * 0.027, true, headColor);
+        if (!overview.fit){
+            stringstream ss;
+            ss << "cells " << first << " to " << first + cells - 1 << " (0 shows all)";
+            graphics::drawShapeAroundText(window, ss.str(), width - graphics::widthOfTextBox(ss.str(), 3, 12) / 2, window.getHeight() * 0.94, window.getHeight() * 0.025, graphics::WHITE, 3, 12);
+        }
+        window.endGroup();
 
-            // binary view
-            if (toStr.at(tape.readAt(i)) == '0'){
-                window.setColor(graphics::DARK_GRAY);
+        if ((size_t)columns != overviewColumns.size()){
+            // columns past the end now are left over from a wider layout
+            for (size_t j = columns; j < overviewColumns.size(); j++){
+                window.beginGroup(WHOLE_TAPE_GROUPS + j);
+                window.endGroup();
             }
-            else if (toStr.at(tape.readAt(i)) == '1'){
-                window.setColor(graphics::BLACK);
+            overviewColumns.assign(columns, ~0ull);
+        }
+        // once the tape is wider than the window, columns stay put as it
+        // grows and only change color
+        bool moved = first != overviewFirst || cells != overviewCells;
+        overviewFirst = first;
+        overviewCells = cells;
+        if (moved || changed.size() >= (size_t)columns){
+            for (int j = 0; j < columns; j++){
+                vizWholeTapeColumn(window, first, cells, columns, j);
             }
-            else{
-                window.setColor(dullerColor(tape.cellColors.at(i)));
+            return;
+        }
+        for (int64_t at : changed){
+            if (at < first || at >= first + cells){
+                continue;
+            }
+            // the column at is in, or for bucketed columns maybe the next
+            int j = (int)(((at - first + 1) * columns - 1) / cells);
+            vizWholeTapeColumn(window, first, cells, columns, j);
+            if (j + 1 < columns){
+                vizWholeTapeColumn(window, first, cells, columns, j + 1);
             }
-            window.fillRect(i * wid, window.getHeight() * 0.875, wid, window.getHeight() * 0.05);
+        }
+    }
+
+    void vizWholeTapeColumn(graphics::Window& window, int64_t first, int64_t cells, int columns, int j){
+        uint64_t colors = overviewColumn(first, cells, columns, j);
+        if (colors == overviewColumns[j]){
+            return;
+        }
+        overviewColumns[j] = colors;
+        int x = (int64_t)j * window.getWidth() / columns;
+        int wid = (int64_t)(j + 1) * window.getWidth() / columns - x;
+        window.beginGroup(WHOLE_TAPE_GROUPS + j);
+        // config-stained view
+        window.setColor(graphics::colorToHex(colors >> 40, colors >> 32 & 0xFF, colors >> 24 & 0xFF));
+        window.fillRect(x, window.getHeight() * 0.825, wid, window.getHeight() * 0.05);
+        // binary view
+        window.setColor(graphics::colorToHex(colors >> 16 & 0xFF, colors >> 8 & 0xFF, colors & 0xFF));
+        window.fillRect(x, window.getHeight() * 0.875, wid, window.getHeight() * 0.05);
+        // cells wide enough to tell apart get borders
+        if (wid >= 4){
             window.setColor(graphics::BLACK);
-            window.drawRect(i * wid, window.getHeight() * 0.875, wid, window.getHeight() * 0.05);
+            window.drawRect(x, window.getHeight() * 0.825, wid, window.getHeight() * 0.05);
+            window.drawRect(x, window.getHeight() * 0.875, wid, window.getHeight() * 0.05);
         }
+        window.endGroup();
     }
 };
\ No newline at end of file
@@ -0,0 +1,230 @@
+#pragma once
+
+// Shared by the graphics backends, not part of the public API.
+
+#include "graphics.h"
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdlib>
+#include <cstdint>
+
+namespace graphics {
+
+// What a Window has been asked to draw, kept as a flat list of plain
+// records for its backend to replay; label text lives in one shared buffer
+// per group. Adding a command is just an append.
+//
+// Commands are kept in groups. Redrawing a group replaces what it drew
+// before, and only the area the old and new drawings cover needs
+// repainting: the backend keeps everything else from the last frame.
+// Commands drawn outside any group stay until clear().
+class DrawList {
+public:
+    enum class Shape : unsigned char {
+        FillRect,
+        Rect,
+        FillOval,
+        Oval,
+        Line,
+        Text,
+        Image
+    };
+
+    // For Line, w and h are the end point; for Text they are the label's
+    // offset and length in its group's labels, and size its font size. An
+    // Image's pixels follow those of the images before it in its group's
+    // pixels.
+    struct DrawCommand {
+        Shape shape;
+        unsigned char size;
+        unsigned char r, g, b;
+        int x, y, w, h;
+    };
+
+    struct Bounds {
+        int x = 0, y = 0, w = 0, h = 0;
+
+        bool empty() const {
+            return w <= 0 || h <= 0;
+        }
+
+        bool intersects(const Bounds& o) const {
+            return !empty() && !o.empty() && x < o.x + o.w && o.x < x + w && y < o.y + o.h && o.y < y + h;
+        }
+    };
+
+    struct Group {
+        std::vector<DrawCommand> commands;
+        std::string labels;
+        std::vector<unsigned char> pixels;  // r, g, b rows of each Image
+        Bounds bounds;      // of everything in commands
+    };
+
+    DrawList() : groups(1) {}
+
+    // groups[0] holds commands drawn outside beginGroup/endGroup, beneath
+    // every group; the others are drawn in the order they were first begun
+    const std::vector<Group>& getGroups() const {
+        return groups;
+    }
+
+    // Empties every group, keeping its place in the drawing order and its
+    // buffers' capacity; everything needs repainting.
+    void clear() {
+        for (Group& group : groups) {
+            group.commands.clear();
+            group.labels.clear();
+            group.pixels.clear();
+            group.bounds = Bounds();
+        }
+        current = 0;
+        dirty.clear();
+        dirtyAll = true;
+    }
+
+    // Commands from here to endGroup() replace the ones group id has.
+    void beginGroup(int id) {
+        auto [it, fresh] = groupIds.try_emplace(id, groups.size());
+        if (fresh) {
+            groups.emplace_back();
+        }
+        current = it->second;
+        Group& group = groups[current];
+        invalidate(group.bounds);
+        // keeps the buffers' capacity, so a steady frame allocates nothing
+        group.commands.clear();
+        group.labels.clear();
+        group.pixels.clear();
+        group.bounds = Bounds();
+    }
+
+    void endGroup() {
+        invalidate(groups[current].bounds);
+        current = 0;
+    }
+
+    void add(Shape shape, const unsigned char* rgb, int x, int y, int w, int h) {
+        groups[current].commands.push_back({shape, 0, rgb[0], rgb[1], rgb[2], x, y, w, h});
+        if (shape == Shape::Line) {
+            cover({std::min(x, w), std::min(y, h), std::abs(w - x) + 1, std::abs(h - y) + 1});
+        } else {
+            cover({x, y, w, h});
+        }
+    }
+
+    // x and y are the start of the baseline; area is what the backend
+    // measured the label to cover
+    void addText(const std::string& text, int size, const unsigned char* rgb, int x, int y, const Bounds& area) {
+        Group& group = groups[current];
+        group.commands.push_back({Shape::Text, (unsigned char)size, rgb[0], rgb[1], rgb[2], x, y, (int)group.labels.size(), (int)text.size()});
+        group.labels += text;
+        cover(area);
+    }
+
+    // w by h pixels of r, g, b, copied
+    void addImage(const unsigned char* rgb, int x, int y, int w, int h) {
+        Group& group = groups[current];
+        group.commands.push_back({Shape::Image, 0, 0, 0, 0, x, y, w, h});
+        group.pixels.insert(group.pixels.end(), rgb, rgb + (size_t)w * h * 3);
+        cover({x, y, w, h});
+    }
+
+    // What needs repainting since the last call: rects, or everything if
+    // all is set.
+    void takeDamage(std::vector<Bounds>& rects, bool& all) {
+        all = dirtyAll || dirty.size() > MAX_DIRTY_RECTS;
+        rects.swap(dirty);
+        dirty.clear();
+        dirtyAll = false;
+    }
+
+private:
+    // past this many separate changes a full repaint is as cheap
+    static const size_t MAX_DIRTY_RECTS = 256;
+
+    std::vector<Group> groups;
+    std::unordered_map<int, size_t> groupIds;
+    size_t current = 0;
+    std::vector<Bounds> dirty;
+    bool dirtyAll = true;
+
+    void invalidate(const Bounds& r) {
+        if (!r.empty() && !dirtyAll) {
+            dirty.push_back(r);
+        }
+    }
+
+    void cover(const Bounds& area) {
+        // one pixel of slack for outlines and antialiasing
+        Bounds r = {area.x - 1, area.y - 1, area.w + 2, area.h + 2};
+        if (current == 0) {
+            invalidate(r);
+        }
+        Bounds& b = groups[current].bounds;
+        if (b.empty()) {
+            b = r;
+            return;
+        }
+        int right = std::max(b.x + b.w, r.x + r.w);
+        int bottom = std::max(b.y + b.h, r.y + r.h);
+        b.x = std::min(b.x, r.x);
+        b.y = std::min(b.y, r.y);
+        b.w = right - b.x;
+        b.h = bottom - b.y;
+    }
+};
+
+// Something worked out from a string of text in a font at a size, such as
+// its width, kept so text drawn every frame is only worked out once. The
+// font and size are part of the key, so a change of font never finds what
+// was worked out for the old one. Holds at most MAX_ENTRIES strings and
+// starts over when full, as some labels (step counts) never repeat.
+template <typename Value>
+class TextCache {
+public:
+    // value for text, from make(text) if it isn't cached yet
+    template <typename Make>
+    const Value& get(int font, int size, const std::string& text, Make make) {
+        uint64_t key = (uint64_t)(uint32_t)font << 32 | (uint32_t)size;
+        if (lastFont == nullptr || key != lastKey) {
+            lastFont = &fonts[key];
+            lastKey = key;
+        }
+        auto found = lastFont->find(text);
+        if (found != lastFont->end()) {
+            return found->second;
+        }
+        if (entries >= MAX_ENTRIES) {
+            clear();
+            lastFont = &fonts[key];
+            lastKey = key;
+        }
+        entries++;
+        return lastFont->emplace(text, make(text)).first->second;
+    }
+
+    void clear() {
+        fonts.clear();
+        lastFont = nullptr;
+        entries = 0;
+    }
+
+private:
+    static const size_t MAX_ENTRIES = 4096;
+
+    // font << 32 | size, then text
+    std::unordered_map<uint64_t, std::unordered_map<std::string, Value>> fonts;
+    // the last font looked up, as most lookups are in the same one
+    std::unordered_map<std::string, Value>* lastFont = nullptr;
+    uint64_t lastKey = 0;
+    size_t entries = 0;
+};
+
+// The #RRGGBB form of a color name (BLACK, RED, ...) or #RRGGBB string;
+// calls error() for anything else.
+std::string resolveColor(const std::string& color);
+
+} // namespace graphics
@@ -1,4 +1,5 @@
 #include "graphics.h"
+#include "drawList.h"
 
 // Use standard FLTK includes (let Homebrew set the include path)
 #include <FL/Fl.H>
@@ -21,84 +22,130 @@
 
 namespace graphics {
 
-// Error handling implementation
-ErrorException::ErrorException(const std::string& msg) : mMsg(msg) {}
-
-std::string ErrorException::getMessage() const {
-    return mMsg;
-}
-
-const char* ErrorException::what() const noexcept {
-    return mMsg.c_str();
-}
-
-void error(const std::string& msg) {
-    throw ErrorException(msg);
-}
-
-// Color conversion utility
-std::string colorToHex(int r, int g, int b) {
-    std::stringstream ss;
-    ss << "#" << std::hex << std::setfill('0') 
-       << std::setw(2) << r
-       << std::setw(2) << g
-       << std::setw(2) << b;
-    return ss.str();
-}
-
-// Convert hex color string to RGB values
-void hexToRgb(const std::string& hex, unsigned char& r, unsigned char& g, unsigned char& b) {
-    if (hex.size() != 7 || hex[0] != '#') {
-        error("Invalid color format. Expected #RRGGBB");
-    }
-    
-    try {
-        r = std::stoi(hex.substr(1, 2), nullptr, 16);
-        g = std::stoi(hex.substr(3, 2), nullptr, 16);
-        b = std::stoi(hex.substr(5, 2), nullptr, 16);
-    } catch (...) {
-        error("Invalid color format. Expected #RRGGBB");
-    }
-}
-
-// Custom drawing area class for FLTK
+// Custom drawing area class for FLTK: replays the window's DrawList on
+// redraws. Drawing calls and FLTK's redraws both happen on the thread
+// running the event loop, so the list needs no lock. Only the damaged
+// area is repainted; the double buffer keeps the rest of the last frame.
 class DrawingArea : public Fl_Box {
 public:
-    DrawingArea(int x, int y, int w, int h) : Fl_Box(x, y, w, h) {
+    DrawList list;
+
+    DrawingArea(int x, int y, int w, int h, std::queue<Event>& events, std::mutex& eventMutex)
+        : Fl_Box(x, y, w, h), events(events), eventMutex(eventMutex) {
         box(FL_FLAT_BOX);
         color(FL_WHITE);
     }
 
+    // Queues mouse presses, drags and releases and key presses for
+    // Window::getEvent().
+    int handle(int event) override {
+        Event e;
+        switch (event) {
+            case FL_PUSH:
+            case FL_DRAG:
+            case FL_RELEASE:
+                e.Type = event == FL_PUSH ? EventType::MouseBtnDown : event == FL_DRAG ? EventType::MouseDrag : EventType::MouseBtnUp;
+                e.Event.Mouse.Button = Fl::event_button();
+                e.Event.Mouse.X = Fl::event_x();
+                e.Event.Mouse.Y = Fl::event_y();
+                break;
+            case FL_KEYDOWN:
+            case FL_KEYUP:
+                e.Type = event == FL_KEYDOWN ? EventType::KeyDown : EventType::KeyUp;
+                e.Event.Key.Code = Fl::event_key();
+                break;
+            case FL_FOCUS:
+            case FL_UNFOCUS:
+                // so key events come here
+                return 1;
+            default:
+                return Fl_Box::handle(event);
+        }
+        std::lock_guard<std::mutex> lock(eventMutex);
+        events.push(e);
+        return 1;
+    }
+
     void draw() override {
+        // only the damaged area is drawn into; the rest is left as it was
         Fl_Box::draw();
         fl_push_clip(x(), y(), w(), h());
-        
-        // Draw all stored shapes
-        std::lock_guard<std::mutex> lock(drawMutex);
-        for (const auto& cmd : drawCommands) {
-            cmd();
+
+        // Draw all stored shapes, only switching colour or font when it changes
+        int lastColor = -1;
+        int lastSize = -1;
+        for (const DrawList::Group& group : list.getGroups()) {
+            if (group.commands.empty() || !fl_not_clipped(group.bounds.x, group.bounds.y, group.bounds.w, group.bounds.h)) {
+                continue;
+            }
+            const unsigned char* pixels = group.pixels.data();
+            for (const DrawList::DrawCommand& cmd : group.commands) {
+                int rgb = cmd.r << 16 | cmd.g << 8 | cmd.b;
+                if (rgb != lastColor) {
+                    fl_color(cmd.r, cmd.g, cmd.b);
+                    lastColor = rgb;
+                }
+                switch (cmd.shape) {
+                    case DrawList::Shape::FillRect: fl_rectf(cmd.x, cmd.y, cmd.w, cmd.h); break;
+                    case DrawList::Shape::Rect: fl_rect(cmd.x, cmd.y, cmd.w, cmd.h); break;
+                    case DrawList::Shape::FillOval: fl_pie(cmd.x, cmd.y, cmd.w, cmd.h, 0, 360); break;
+                    case DrawList::Shape::Oval: fl_arc(cmd.x, cmd.y, cmd.w, cmd.h, 0, 360); break;
+                    case DrawList::Shape::Line: fl_line(cmd.x, cmd.y, cmd.w, cmd.h); break;
+                    case DrawList::Shape::Text:
+                        if (cmd.size != lastSize) {
+                            fl_font(FL_HELVETICA, cmd.size);
+                            lastSize = cmd.size;
+                        }
+                        fl_draw(group.labels.data() + cmd.w, cmd.h, cmd.x, cmd.y);
+                        break;
+                    case DrawList::Shape::Image:
+                        fl_draw_image(pixels, cmd.x, cmd.y, cmd.w, cmd.h, 3);
+                        pixels += (size_t)cmd.w * cmd.h * 3;
+                        break;
+                }
+            }
         }
-        
-        fl_pop_clip();
-    }
 
-    void clear() {
-        std::lock_guard<std::mutex> lock(drawMutex);
-        drawCommands.clear();
-        redraw();
+        fl_pop_clip();
     }
 
-    void addDrawCommand(std::function<void()> command) {
-        std::lock_guard<std::mutex> lock(drawMutex);
-        drawCommands.push_back(command);
-        redraw();
+    // Asks FLTK to repaint what changed since the last call.
+    void flushDamage() {
+        bool all;
+        list.takeDamage(dirty, all);
+        if (all) {
+            redraw();
+        } else {
+            for (const DrawList::Bounds& r : dirty) {
+                damage(FL_DAMAGE_USER1, r.x, r.y, r.w, r.h);
+            }
+        }
     }
 
 private:
-    std::vector<std::function<void()>> drawCommands;
-    std::mutex drawMutex;
+    std::vector<DrawList::Bounds> dirty;
+    std::queue<Event>& events;
+    std::mutex& eventMutex;
+};
+
+// Measuring text means switching FLTK's font, so what has been measured
+// is kept: labels are mostly the same from frame to frame.
+static TextCache<int> textWidths;
+
+struct LineMetrics {
+    int height, descent;
 };
 
+static const LineMetrics& lineMetrics(int size) {
+    static std::unordered_map<int, LineMetrics> metrics;
+    auto found = metrics.find(size);
+    if (found == metrics.end()) {
+        fl_font(FL_HELVETICA, size);
+        found = metrics.emplace(size, LineMetrics{fl_height(), fl_descent()}).first;
+    }
+    return found->second;
+}
+
 // Simple window implementation
 class WindowImpl {
 public:
@@ -107,6 +154,8 @@ public:
     std::queue<Event> eventQueue;
     std::mutex eventMutex;
     std::string currentColor;
+    unsigned char currentRgb[3] = {0, 0, 0};    // currentColor, parsed
+    int fontSize = 14;
     bool shouldTerminateOnClose;
     
     WindowImpl(int width, int height, const std::string& title) {
@@ -114,7 +163,7 @@ public:
         Fl::visual(FL_DOUBLE | FL_RGB);
         
         window = new Fl_Double_Window(width, height, title.c_str());
-        drawArea = new DrawingArea(0, 0, width, height);
+        drawArea = new DrawingArea(0, 0, width, height, eventQueue, eventMutex);
         window->end();
         
         // Simple callback for closing
@@ -196,35 +245,27 @@ void Window::setTerminateOnClose(bool terminate) {
 }
 
 void Window::clear() {
-    mImpl->drawArea->clear();
+    mImpl->drawArea->list.clear();
+}
+
+void Window::beginGroup(int id) {
+    mImpl->drawArea->list.beginGroup(id);
+}
+
+void Window::endGroup() {
+    mImpl->drawArea->list.endGroup();
 }
 
 void Window::setColor(const std::string& color) {
-    // Handle both predefined colors and hex format
-    static const std::unordered_map<std::string, std::string> colorMap = {
-        {"BLACK", BLACK},
-        {"BLUE", BLUE},
-        {"CYAN", CYAN},
-        {"DARK_GRAY", DARK_GRAY},
-        {"GRAY", GRAY},
-        {"GREEN", GREEN},
-        {"LIGHT_GRAY", LIGHT_GRAY},
-        {"MAGENTA", MAGENTA},
-        {"ORANGE", ORANGE},
-        {"PINK", PINK},
-        {"RED", RED},
-        {"WHITE", WHITE},
-        {"YELLOW", YELLOW}
-    };
-    
-    auto it = colorMap.find(color);
-    if (it != colorMap.end()) {
-        mImpl->currentColor = it->second;
-    } else if (color[0] == '#' && color.length() == 7) {
-        mImpl->currentColor = color;
-    } else {
-        error("Invalid color: " + color);
+    if (color == mImpl->currentColor) {
+        return;
     }
+    mImpl->currentColor = resolveColor(color);
+    hexToRgb(mImpl->currentColor, mImpl->currentRgb[0], mImpl->currentRgb[1], mImpl->currentRgb[2]);
+}
+
+void Window::setFontSize(int size) {
+    mImpl->fontSize = std::max(1, std::min(size, 255));
 }
 
 std::string Window::getColor() const {
@@ -232,23 +273,11 @@ std::string Window::getColor() const {
 }
 
 void Window::fillRect(int x, int y, int width, int height) {
-    unsigned char r, g, b;
-    hexToRgb(mImpl->currentColor, r, g, b);
-    
-    mImpl->drawArea->addDrawCommand([x, y, width, height, r, g, b]() {
-        fl_color(r, g, b);
-        fl_rectf(x, y, width, height);
-    });
+    mImpl->drawArea->list.add(DrawList::Shape::FillRect, mImpl->currentRgb, x, y, width, height);
 }
 
 void Window::fillOval(int x, int y, int width, int height) {
-    unsigned char r, g, b;
-    hexToRgb(mImpl->currentColor, r, g, b);
-    
-    mImpl->drawArea->addDrawCommand([x, y, width, height, r, g, b]() {
-        fl_color(r, g, b);
-        fl_pie(x, y, width, height, 0, 360);
-    });
+    mImpl->drawArea->list.add(DrawList::Shape::FillOval, mImpl->currentRgb, x, y, width, height);
 }
 
 void Window::fillCircle(int centerX, int centerY, int radius) {
@@ -256,23 +285,11 @@ void Window::fillCircle(int centerX, int centerY, int radius) {
 }
 
 void Window::drawRect(int x, int y, int width, int height) {
-    unsigned char r, g, b;
-    hexToRgb(mImpl->currentColor, r, g, b);
-    
-    mImpl->drawArea->addDrawCommand([x, y, width, height, r, g, b]() {
-        fl_color(r, g, b);
-        fl_rect(x, y, width, height);
-    });
+    mImpl->drawArea->list.add(DrawList::Shape::Rect, mImpl->currentRgb, x, y, width, height);
 }
 
 void Window::drawOval(int x, int y, int width, int height) {
-    unsigned char r, g, b;
-    hexToRgb(mImpl->currentColor, r, g, b);
-    
-    mImpl->drawArea->addDrawCommand([x, y, width, height, r, g, b]() {
-        fl_color(r, g, b);
-        fl_arc(x, y, width, height, 0, 360);
-    });
+    mImpl->drawArea->list.add(DrawList::Shape::Oval, mImpl->currentRgb, x, y, width, height);
 }
 
 void Window::drawCircle(int centerX, int centerY, int radius) {
@@ -280,23 +297,18 @@ void Window::drawCircle(int centerX, int centerY, int radius) {
 }
 
 void Window::drawLine(int x0, int y0, int x1, int y1) {
-    unsigned char r, g, b;
-    hexToRgb(mImpl->currentColor, r, g, b);
-    
-    mImpl->drawArea->addDrawCommand([x0, y0, x1, y1, r, g, b]() {
-        fl_color(r, g, b);
-        fl_line(x0, y0, x1, y1);
-    });
+    mImpl->drawArea->list.add(DrawList::Shape::Line, mImpl->currentRgb, x0, y0, x1, y1);
+}
+
+void Window::drawImage(const unsigned char* rgb, int x, int y, int width, int height) {
+    mImpl->drawArea->list.addImage(rgb, x, y, width, height);
 }
 
 void Window::drawLabel(const std::string& text, int x, int y) {
-    unsigned char r, g, b;
-    hexToRgb(mImpl->currentColor, r, g, b);
-    
-    mImpl->drawArea->addDrawCommand([text, x, y, r, g, b]() {
-        fl_color(r, g, b);
-        fl_draw(text.c_str(), x, y);
-    });
+    // x and y are the start of the baseline
+    const LineMetrics& line = lineMetrics(mImpl->fontSize);
+    DrawList::Bounds area = {x, y - line.height + line.descent, textWidth(text, mImpl->fontSize) + 1, line.height};
+    mImpl->drawArea->list.addText(text, mImpl->fontSize, mImpl->currentRgb, x, y, area);
 }
 
 int Window::getWidth() const {
@@ -339,7 +351,7 @@ Event Window::getEvent() {
 }
 
 void Window::update() {
-    mImpl->window->redraw();
+    mImpl->drawArea->flushDamage();
     Fl::check();
 }
 
@@ -347,6 +359,10 @@ bool Window::isOpen() const {
     return mImpl->window && mImpl->window->shown();
 }
 
+void Window::recordFrames(const std::string& pattern, unsigned threads, uint64_t maxFrames) {
+    error("Recording frames needs the software graphics backend");
+}
+
 
 
 // Terminal implementation
@@ -395,151 +411,11 @@ bool Terminal::isOpen() const {
     return mImpl->window && mImpl->window->shown();
 }
 
-void pause(double milliseconds) {
-    std::this_thread::sleep_for(std::chrono::milliseconds(static_cast<long>(milliseconds)));
-}
-
-void drawShapeWithText(Window& window, const std::string& text, 
-    int centerX, int centerY, int width, int height, 
-    bool isSquare, 
-    const std::string& fillColor,
-    int txtSize,
-    const std::string& borderColor,
-    const std::string& textColor) {
-            fl_font(FL_HELVETICA, txtSize); // Set font and size
-
-// Calculate top-left corner from center point
-int x = centerX - width / 2;
-int y = centerY - height / 2;
-
-// Draw the shape with fill color
-window.setColor(fillColor);
-if (isSquare) {
-window.fillRect(x, y, width, height);
-} else {
-window.fillOval(x, y, width, height);
-}
-
-// Draw the border
-window.setColor(borderColor);
-if (isSquare) {
-window.drawRect(x, y, width, height);
-} else {
-window.drawOval(x, y, width, height);
-}
-
-// Draw centered text
-window.setColor(textColor);
-
-// Better text positioning
-int charWidth = 7;  // More accurate for monospace
-int textWidth = text.length() * charWidth;
-int textHeight = 14;
-
-// Ensure text fits within shape
-if (textWidth > width - 4) {
-// Text too wide, just center what we can
-textWidth = width - 4;
-}
-
-int textX = centerX - textWidth / 2;
-int textY = centerY + textHeight / 4;  // Slight adjustment for baseline
-
-window.drawLabel(text, textX, textY);
-}
-
-
-// int widthOfTextBox(const std::string& text, int padding){
-//     // More generous text width estimate
-    
-//     int charWidth = 12;  
-//     int textWidth = text.length() * charWidth;
-
-//     // Add minimum width to prevent too-thin boxes
-//     return textWidth + (padding * 2);
-// }
-
-
-// void drawShapeAroundText(Window& window, const std::string& text,
-//     int centerX, int centerY, int height, 
-//     const std::string& fillColor,
-//     int padding,
-//     bool isSquare,
-//     const std::string& borderColor,
-//     const std::string& textColor) {
-//         // More generous text width estimate
-//         int charWidth = text.length() < 2 ? 5 : text.length() < 3 ? 7 : 12;  
-//         int textWidth = text.length() * charWidth;
-
-//         // Add minimum width to prevent too-thin boxes
-//         int width = std::max(textWidth + (padding * 2), 50);
-
-//         // Calculate top-left corner
-//         int x = centerX - width / 2;
-//         int y = centerY - height / 2;
-
-//         // Draw shape
-//         window.setColor(fillColor);
-//         if (isSquare) {
-//         window.fillRect(x, y, width, height);
-//         } else {
-//         window.fillOval(x, y, width, height);
-//         }
-
-//         // Draw border
-//         window.setColor(borderColor);
-//         if (isSquare) {
-//         window.drawRect(x, y, width, height);
-//         } else {
-//         window.drawOval(x, y, width, height);
-//         }
-
-//         // Draw text - properly centered
-//         window.setColor(textColor);
-//         int textX = (centerX - (text.length() * charWidth) / 2) + (charWidth * (charWidth > 7));  // Center the text
-//         int textY = centerY + 5;   // FLTK draws from baseline
-
-//         window.drawLabel(text, textX, textY);
-// }
-
-int widthOfTextBox(const std::string& text, int padding, int txtSize) {
-    fl_font(FL_HELVETICA, txtSize); // Set font and size
-    int textWidth = fl_width(text.c_str());
-    return textWidth + (padding * 2);
-}
-
-void drawShapeAroundText(Window& window, const std::string& text,
-    int centerX, int centerY, int height,
-    const std::string& fillColor,
-    int padding,
-    int txtSize,
-    bool isSquare,
-    const std::string& borderColor,
-    const std::string& textColor) {
-
-    fl_font(FL_HELVETICA, txtSize); // Set font and size
-    int textWidth = fl_width(text.c_str());
-    int width = std::max(textWidth + (padding * 2), textWidth+2);
-
-    int x = centerX - width / 2;
-    int y = centerY - height / 2;
-
-    window.setColor(fillColor);
-    if (isSquare) window.fillRect(x, y, width, height);
-    else window.fillOval(x, y, width, height);
-
-    window.setColor(borderColor);
-    if (isSquare) window.drawRect(x, y, width, height);
-    else window.drawOval(x, y, width, height);
-
-    window.setColor(textColor);
-    int textX = centerX - textWidth / 2;
-    int textY = centerY + height / 9; // baseline adjustment
-    window.drawLabel(text, textX, textY);
+int textWidth(const std::string& text, int txtSize) {
+    return textWidths.get(FL_HELVETICA, txtSize, text, [txtSize](const std::string& text) {
+        fl_font(FL_HELVETICA, txtSize);
+        return (int)fl_width(text.c_str(), (int)text.size());
+    });
 }
 
-
-
-
-
 } // namespace graphics
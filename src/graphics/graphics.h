@@ -4,6 +4,7 @@
 #include <memory>
 #include <functional>
 #include <exception>
+#include <cstdint>
 
 namespace graphics {
 
@@ -13,7 +14,8 @@ enum class EventType {
     KeyDown,
     KeyUp,
     MouseBtnDown,
-    MouseBtnUp
+    MouseBtnUp,
+    MouseDrag       // moved with a button held down
 };
 
 // Key codes for non a-z or 0-9 keys we support
@@ -121,8 +123,15 @@ public:
     Window& operator=(const Window&) = delete;
     void setTerminateOnClose(bool terminate);
     void clear();
+    // Drawing between beginGroup(id) and endGroup() replaces whatever the
+    // last group with that id drew; update() then repaints only the area
+    // the old and new drawings cover. clear() empties every group.
+    void beginGroup(int id);
+    void endGroup();
     void setColor(const std::string& color);
     std::string getColor() const;
+    // size of the labels drawLabel draws from now on (default 14)
+    void setFontSize(int size);
     void fillRect(int x, int y, int width, int height);
     void fillOval(int x, int y, int width, int height);
     void fillCircle(int centerX, int centerY, int radius);
@@ -131,12 +140,24 @@ public:
     void drawCircle(int centerX, int centerY, int radius);
     void drawLine(int x0, int y0, int x1, int y1);
     void drawLabel(const std::string& text, int x, int y);
+    // width by height pixels, rows of r, g, b from the top left; copied,
+    // so rgb can be reused straight away
+    void drawImage(const unsigned char* rgb, int x, int y, int width, int height);
     int getWidth() const;
     int getHeight() const;
     bool hasEvents() const;
     struct Event getEvent();
     void update();
     bool isOpen() const;
+    // Software backend only: from now on every update() also writes the
+    // frame to an image file, named by pattern (printf-style, given the
+    // frame number, counting from 0) and in PNG or, if pattern ends in
+    // .ppm, PPM. Frames are encoded on threads worker threads (0 for one
+    // per core). An empty pattern stops recording once the frames already
+    // taken are written, and calls error() if any of them couldn't be.
+    // With no one to close it, the window is open only while recording,
+    // and until maxFrames frames are taken if maxFrames isn't 0.
+    void recordFrames(const std::string& pattern, unsigned threads = 0, uint64_t maxFrames = 0);
 private:
     std::unique_ptr<WindowImpl> mImpl;
 };
@@ -159,9 +180,33 @@ private:
     std::unique_ptr<TerminalImpl> mImpl;
 };
 
+class ImageWriterImpl;
+
+// Writes an RGB image to a file a row at a time, so it never has to be
+// held in memory: PNG, or PPM if path ends in .ppm. The height is however
+// many rows were written by close(). Calls error() if the file can't be
+// written.
+class ImageWriter {
+public:
+    ImageWriter(const std::string& path, int width);
+    ~ImageWriter();
+    ImageWriter(const ImageWriter&) = delete;
+    ImageWriter& operator=(const ImageWriter&) = delete;
+    // width pixels of r, g, b
+    void writeRow(const unsigned char* rgb);
+    int getRows() const;
+    void close();
+private:
+    std::unique_ptr<ImageWriterImpl> mImpl;
+};
+
 // Utility functions
 void pause(double milliseconds);
 std::string colorToHex(int r, int g, int b);
+void hexToRgb(const std::string& hex, unsigned char& r, unsigned char& g, unsigned char& b);
+
+// Width in pixels of text drawn at txtSize.
+int textWidth(const std::string& text, int txtSize = 14);
 
 void drawShapeWithText(Window& window, const std::string& text, 
     int centerX, int centerY, int width, int height, 
@@ -0,0 +1,454 @@
+// The parts of graphics that don't depend on a backend: errors, colors,
+// image files and the shape-and-label helpers, which draw through Window's
+// API.
+
+#include "graphics.h"
+#include "drawList.h"
+
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+#include <unordered_map>
+#include <fstream>
+#include <vector>
+#include <cstdint>
+
+#if GRAPHICS_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace graphics {
+
+// Error handling implementation
+ErrorException::ErrorException(const std::string& msg) : mMsg(msg) {}
+
+std::string ErrorException::getMessage() const {
+    return mMsg;
+}
+
+const char* ErrorException::what() const noexcept {
+    return mMsg.c_str();
+}
+
+void error(const std::string& msg) {
+    throw ErrorException(msg);
+}
+
+// Color conversion utility
+std::string colorToHex(int r, int g, int b) {
+    std::stringstream ss;
+    ss << "#" << std::hex << std::setfill('0') 
+       << std::setw(2) << r
+       << std::setw(2) << g
+       << std::setw(2) << b;
+    return ss.str();
+}
+
+// Convert hex color string to RGB values
+void hexToRgb(const std::string& hex, unsigned char& r, unsigned char& g, unsigned char& b) {
+    if (hex.size() != 7 || hex[0] != '#') {
+        error("Invalid color format. Expected #RRGGBB");
+    }
+    
+    auto digit = [](char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        error("Invalid color format. Expected #RRGGBB");
+        return 0;
+    };
+    r = digit(hex[1]) << 4 | digit(hex[2]);
+    g = digit(hex[3]) << 4 | digit(hex[4]);
+    b = digit(hex[5]) << 4 | digit(hex[6]);
+}
+
+std::string resolveColor(const std::string& color) {
+    // Handle both predefined colors and hex format
+    static const std::unordered_map<std::string, std::string> colorMap = {
+        {"BLACK", BLACK},
+        {"BLUE", BLUE},
+        {"CYAN", CYAN},
+        {"DARK_GRAY", DARK_GRAY},
+        {"GRAY", GRAY},
+        {"GREEN", GREEN},
+        {"LIGHT_GRAY", LIGHT_GRAY},
+        {"MAGENTA", MAGENTA},
+        {"ORANGE", ORANGE},
+        {"PINK", PINK},
+        {"RED", RED},
+        {"WHITE", WHITE},
+        {"YELLOW", YELLOW}
+    };
+    
+    if (color.length() == 7 && color[0] == '#') {
+        return color;
+    }
+    auto it = colorMap.find(color);
+    if (it == colorMap.end()) {
+        error("Invalid color: " + color);
+    }
+    return it->second;
+}
+
+static void putBigEndian(std::string& out, uint32_t v) {
+    out += (char)(v >> 24);
+    out += (char)(v >> 16);
+    out += (char)(v >> 8);
+    out += (char)v;
+}
+
+static uint32_t crc32(const unsigned char* data, size_t n, uint32_t crc = 0) {
+    static const std::vector<uint32_t> table = [] {
+        std::vector<uint32_t> t(256);
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) {
+                c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            t[i] = c;
+        }
+        return t;
+    }();
+    crc = ~crc;
+    for (size_t i = 0; i < n; i++) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+// PNG's IDAT data is one zlib stream, compressed as it goes if zlib was
+// found at build time, and otherwise made of stored (uncompressed) deflate
+// blocks. It is written out in chunks of about CHUNK_BYTES.
+class ImageWriterImpl {
+public:
+    static const size_t CHUNK_BYTES = 1 << 16;
+
+    std::string path;
+    std::ofstream file;
+    int width;
+    int rows = 0;
+    bool ppm;
+    bool closed = false;
+    std::string row;        // the row being written, filtered for PNG
+    std::string pending;    // compressed data not yet in a chunk
+#if GRAPHICS_HAVE_ZLIB
+    z_stream stream;
+#else
+    uint32_t adlerA = 1, adlerB = 0;
+#endif
+
+    ImageWriterImpl(const std::string& path, int width) : path(path), file(path, std::ios::binary | std::ios::trunc), width(width) {
+        ppm = path.size() >= 4 && path.compare(path.size() - 4, 4, ".ppm") == 0;
+        if (!file) {
+            error("Failed to write image: " + path);
+        }
+        if (ppm) {
+            // the height is filled in by close(), padded with spaces
+            file << "P6\n" << width << " " << std::string(HEIGHT_DIGITS, ' ') << "\n255\n";
+            return;
+        }
+        std::string header = "\x89PNG\r\n\x1a\n";
+        std::string ihdr;
+        putBigEndian(ihdr, width);
+        putBigEndian(ihdr, 0);
+        ihdr += std::string("\x08\x02\x00\x00\x00", 5);   // 8-bit RGB, no interlace
+        chunk(header, "IHDR", ihdr);
+        file.write(header.data(), header.size());
+#if GRAPHICS_HAVE_ZLIB
+        stream = z_stream();
+        deflateInit(&stream, Z_BEST_SPEED);
+#else
+        pending = "\x78\x01";
+#endif
+    }
+
+    ~ImageWriterImpl() {
+#if GRAPHICS_HAVE_ZLIB
+        if (!ppm) {
+            deflateEnd(&stream);
+        }
+#endif
+    }
+
+    void writeRow(const unsigned char* rgb) {
+        if (ppm) {
+            file.write((const char*)rgb, (size_t)width * 3);
+        } else {
+            // the Sub filter: flat runs of color become runs of zeros
+            row.resize((size_t)width * 3 + 1);
+            row[0] = 1;
+            for (int i = 0; i < width * 3; i++) {
+                row[i + 1] = (char)(rgb[i] - (i >= 3 ? rgb[i - 3] : 0));
+            }
+            compress(row, false);
+        }
+        rows++;
+        if (!file) {
+            error("Failed to write image: " + path);
+        }
+    }
+
+    void close() {
+        if (closed) {
+            return;
+        }
+        closed = true;
+        if (ppm) {
+            std::string height = std::to_string(rows);
+            file.seekp(3 + std::to_string(width).size() + 1);
+            file.write(height.data(), height.size());
+        } else {
+            compress("", true);
+            std::string tail;
+            chunk(tail, "IEND", "");
+            file.write(tail.data(), tail.size());
+            // the real height, and so IHDR's CRC
+            std::string ihdr;
+            putBigEndian(ihdr, width);
+            putBigEndian(ihdr, rows);
+            ihdr += std::string("\x08\x02\x00\x00\x00", 5);
+            std::string fixed;
+            chunk(fixed, "IHDR", ihdr);
+            file.seekp(8);
+            file.write(fixed.data(), fixed.size());
+        }
+        file.close();
+        if (!file) {
+            error("Failed to write image: " + path);
+        }
+    }
+
+private:
+    // room for the height in a PPM header
+    static const size_t HEIGHT_DIGITS = 10;
+
+    static void chunk(std::string& out, const char* type, const std::string& data) {
+        putBigEndian(out, data.size());
+        size_t start = out.size();
+        out.append(type, 4);
+        out += data;
+        putBigEndian(out, crc32((const unsigned char*)out.data() + start, out.size() - start));
+    }
+
+    void flushChunk() {
+        std::string out;
+        chunk(out, "IDAT", pending);
+        file.write(out.data(), out.size());
+        pending.clear();
+    }
+
+    // adds raw to the zlib stream, ending it if last
+    void compress(const std::string& raw, bool last) {
+#if GRAPHICS_HAVE_ZLIB
+        stream.next_in = (Bytef*)raw.data();
+        stream.avail_in = raw.size();
+        char buffer[CHUNK_BYTES];
+        int status;
+        do {
+            stream.next_out = (Bytef*)buffer;
+            stream.avail_out = sizeof(buffer);
+            status = deflate(&stream, last ? Z_FINISH : Z_NO_FLUSH);
+            pending.append(buffer, sizeof(buffer) - stream.avail_out);
+            if (pending.size() >= CHUNK_BYTES) {
+                flushChunk();
+            }
+        } while (stream.avail_out == 0 || (last && status != Z_STREAM_END));
+#else
+        for (unsigned char c : raw) {
+            adlerA = (adlerA + c) % 65521;
+            adlerB = (adlerB + adlerA) % 65521;
+        }
+        size_t pos = 0;
+        // the stream ends with an empty final block
+        while (pos < raw.size() || last) {
+            size_t n = std::min<size_t>(raw.size() - pos, 65535);
+            pending += (char)(last && pos + n == raw.size() ? 1 : 0);
+            pending += (char)(n & 0xFF);
+            pending += (char)(n >> 8);
+            pending += (char)(~n & 0xFF);
+            pending += (char)((~n >> 8) & 0xFF);
+            pending.append(raw, pos, n);
+            pos += n;
+            if (pending.size() >= CHUNK_BYTES) {
+                flushChunk();
+            }
+            if (last && pos == raw.size()) {
+                break;
+            }
+        }
+        if (last) {
+            putBigEndian(pending, adlerB << 16 | adlerA);
+        }
+#endif
+        if (last && !pending.empty()) {
+            flushChunk();
+        }
+    }
+};
+
+ImageWriter::ImageWriter(const std::string& path, int width) : mImpl(new ImageWriterImpl(path, width)) {
+}
+
+ImageWriter::~ImageWriter() {
+    try {
+        mImpl->close();
+    } catch (const ErrorException&) {
+        // too late to report
+    }
+}
+
+void ImageWriter::writeRow(const unsigned char* rgb) {
+    mImpl->writeRow(rgb);
+}
+
+int ImageWriter::getRows() const {
+    return mImpl->rows;
+}
+
+void ImageWriter::close() {
+    mImpl->close();
+}
+
+void pause(double milliseconds) {
+    std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(milliseconds));
+}
+
+void drawShapeWithText(Window& window, const std::string& text, 
+    int centerX, int centerY, int width, int height, 
+    bool isSquare, 
+    const std::string& fillColor,
+    int txtSize,
+    const std::string& borderColor,
+    const std::string& textColor) {
+            window.setFontSize(txtSize); // Set font size
+
+// Calculate top-left corner from center point
+int x = centerX - width / 2;
+int y = centerY - height / 2;
+
+// Draw the shape with fill color
+window.setColor(fillColor);
+if (isSquare) {
+window.fillRect(x, y, width, height);
+} else {
+window.fillOval(x, y, width, height);
+}
+
+// Draw the border
+window.setColor(borderColor);
+if (isSquare) {
+window.drawRect(x, y, width, height);
+} else {
+window.drawOval(x, y, width, height);
+}
+
+// Draw centered text
+window.setColor(textColor);
+
+// Better text positioning
+int labelWidth = textWidth(text, txtSize);
+int textHeight = txtSize;
+
+// Ensure text fits within shape
+if (labelWidth > width - 4) {
+// Text too wide, just center what we can
+labelWidth = width - 4;
+}
+
+int textX = centerX - labelWidth / 2;
+int textY = centerY + textHeight / 4;  // Slight adjustment for baseline
+
+window.drawLabel(text, textX, textY);
+}
+
+
+// int widthOfTextBox(const std::string& text, int padding){
+//     // More generous text width estimate
+    
+//     int charWidth = 12;  
+//     int textWidth = text.length() * charWidth;
+
+//     // Add minimum width to prevent too-thin boxes
+//     return textWidth + (padding * 2);
+// }
+
+
+// void drawShapeAroundText(Window& window, const std::string& text,
+//     int centerX, int centerY, int height, 
+//     const std::string& fillColor,
+//     int padding,
+//     bool isSquare,
+//     const std::string& borderColor,
+//     const std::string& textColor) {
+//         // More generous text width estimate
+//         int charWidth = text.length() < 2 ? 5 : text.length() < 3 ? 7 : 12;  
+//         int textWidth = text.length() * charWidth;
+
+//         // Add minimum width to prevent too-thin boxes
+//         int width = std::max(textWidth + (padding * 2), 50);
+
+//         // Calculate top-left corner
+//         int x = centerX - width / 2;
+//         int y = centerY - height / 2;
+
+//         // Draw shape
+//         window.setColor(fillColor);
+//         if (isSquare) {
+//         window.fillRect(x, y, width, height);
+//         } else {
+//         window.fillOval(x, y, width, height);
+//         }
+
+//         // Draw border
+//         window.setColor(borderColor);
+//         if (isSquare) {
+//         window.drawRect(x, y, width, height);
+//         } else {
+//         window.drawOval(x, y, width, height);
+//         }
+
+//         // Draw text - properly centered
+//         window.setColor(textColor);
+//         int textX = (centerX - (text.length() * charWidth) / 2) + (charWidth * (charWidth > 7));  // Center the text
+//         int textY = centerY + 5;   // FLTK draws from baseline
+
+//         window.drawLabel(text, textX, textY);
+// }
+
+int widthOfTextBox(const std::string& text, int padding, int txtSize) {
+    return textWidth(text, txtSize) + (padding * 2);
+}
+
+void drawShapeAroundText(Window& window, const std::string& text,
+    int centerX, int centerY, int height,
+    const std::string& fillColor,
+    int padding,
+    int txtSize,
+    bool isSquare,
+    const std::string& borderColor,
+    const std::string& textColor) {
+
+    int labelWidth = textWidth(text, txtSize);
+    int width = std::max(labelWidth + (padding * 2), labelWidth+2);
+
+    int x = centerX - width / 2;
+    int y = centerY - height / 2;
+
+    window.setColor(fillColor);
+    if (isSquare) window.fillRect(x, y, width, height);
+    else window.fillOval(x, y, width, height);
+
+    window.setColor(borderColor);
+    if (isSquare) window.drawRect(x, y, width, height);
+    else window.drawOval(x, y, width, height);
+
+    window.setColor(textColor);
+    window.setFontSize(txtSize);
+    int textX = centerX - labelWidth / 2;
+    int textY = centerY + height / 9; // baseline adjustment
+    window.drawLabel(text, textX, textY);
+}
+
+} // namespace graphics
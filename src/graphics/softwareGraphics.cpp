@@ -0,0 +1,707 @@
+#include "graphics.h"
+#include "drawList.h"
+
+// Software backend for graphics::Window, for machines with no display:
+// draws into an in-memory RGB framebuffer with a built-in 5x7 bitmap font,
+// and can write every frame to a PNG or PPM file. Link this instead of
+// graphics.cpp; there are no windows or events, and Terminal writes to
+// standard output.
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+
+namespace graphics {
+
+// ASCII 32 to 126, one byte per row from the top, bit 4 the leftmost column
+static const unsigned char FONT_5X7[95][7] = {
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},  // space
+    {0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x04},  // !
+    {0x0A, 0x0A, 0x0A, 0x00, 0x00, 0x00, 0x00},  // "
+    {0x0A, 0x0A, 0x1F, 0x0A, 0x1F, 0x0A, 0x0A},  // #
+    {0x04, 0x0F, 0x14, 0x0E, 0x05, 0x1E, 0x04},  // $
+    {0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03},  // %
+    {0x0C, 0x12, 0x14, 0x08, 0x15, 0x12, 0x0D},  // &
+    {0x04, 0x04, 0x08, 0x00, 0x00, 0x00, 0x00},  // '
+    {0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02},  // (
+    {0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08},  // )
+    {0x00, 0x04, 0x15, 0x0E, 0x15, 0x04, 0x00},  // *
+    {0x00, 0x04, 0x04, 0x1F, 0x04, 0x04, 0x00},  // +
+    {0x00, 0x00, 0x00, 0x00, 0x0C, 0x04, 0x08},  // ,
+    {0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00},  // -
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C},  // .
+    {0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00},  // /
+    {0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E},  // 0
+    {0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E},  // 1
+    {0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F},  // 2
+    {0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E},  // 3
+    {0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02},  // 4
+    {0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E},  // 5
+    {0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E},  // 6
+    {0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08},  // 7
+    {0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E},  // 8
+    {0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C},  // 9
+    {0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00},  // :
+    {0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x04, 0x08},  // ;
+    {0x02, 0x04, 0x08, 0x10, 0x08, 0x04, 0x02},  // <
+    {0x00, 0x00, 0x1F, 0x00, 0x1F, 0x00, 0x00},  // =
+    {0x08, 0x04, 0x02, 0x01, 0x02, 0x04, 0x08},  // >
+    {0x0E, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04},  // ?
+    {0x0E, 0x11, 0x01, 0x0D, 0x15, 0x15, 0x0E},  // @
+    {0x0E, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11},  // A
+    {0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E},  // B
+    {0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E},  // C
+    {0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C},  // D
+    {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F},  // E
+    {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10},  // F
+    {0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F},  // G
+    {0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11},  // H
+    {0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E},  // I
+    {0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C},  // J
+    {0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11},  // K
+    {0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F},  // L
+    {0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11},  // M
+    {0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11},  // N
+    {0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E},  // O
+    {0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10},  // P
+    {0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D},  // Q
+    {0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11},  // R
+    {0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E},  // S
+    {0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04},  // T
+    {0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E},  // U
+    {0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04},  // V
+    {0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A},  // W
+    {0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11},  // X
+    {0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04},  // Y
+    {0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F},  // Z
+    {0x0E, 0x08, 0x08, 0x08, 0x08, 0x08, 0x0E},  // [
+    {0x00, 0x10, 0x08, 0x04, 0x02, 0x01, 0x00},  // backslash
+    {0x0E, 0x02, 0x02, 0x02, 0x02, 0x02, 0x0E},  // ]
+    {0x04, 0x0A, 0x11, 0x00, 0x00, 0x00, 0x00},  // ^
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F},  // _
+    {0x08, 0x04, 0x02, 0x00, 0x00, 0x00, 0x00},  // `
+    {0x00, 0x00, 0x0E, 0x01, 0x0F, 0x11, 0x0F},  // a
+    {0x10, 0x10, 0x16, 0x19, 0x11, 0x11, 0x1E},  // b
+    {0x00, 0x00, 0x0E, 0x10, 0x10, 0x11, 0x0E},  // c
+    {0x01, 0x01, 0x0D, 0x13, 0x11, 0x11, 0x0F},  // d
+    {0x00, 0x00, 0x0E, 0x11, 0x1F, 0x10, 0x0E},  // e
+    {0x06, 0x09, 0x08, 0x1C, 0x08, 0x08, 0x08},  // f
+    {0x00, 0x0F, 0x11, 0x11, 0x0F, 0x01, 0x0E},  // g
+    {0x10, 0x10, 0x16, 0x19, 0x11, 0x11, 0x11},  // h
+    {0x04, 0x00, 0x0C, 0x04, 0x04, 0x04, 0x0E},  // i
+    {0x02, 0x00, 0x06, 0x02, 0x02, 0x12, 0x0C},  // j
+    {0x10, 0x10, 0x12, 0x14, 0x18, 0x14, 0x12},  // k
+    {0x0C, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E},  // l
+    {0x00, 0x00, 0x1A, 0x15, 0x15, 0x11, 0x11},  // m
+    {0x00, 0x00, 0x16, 0x19, 0x11, 0x11, 0x11},  // n
+    {0x00, 0x00, 0x0E, 0x11, 0x11, 0x11, 0x0E},  // o
+    {0x00, 0x00, 0x1E, 0x11, 0x1E, 0x10, 0x10},  // p
+    {0x00, 0x00, 0x0D, 0x13, 0x0F, 0x01, 0x01},  // q
+    {0x00, 0x00, 0x16, 0x19, 0x10, 0x10, 0x10},  // r
+    {0x00, 0x00, 0x0E, 0x10, 0x0E, 0x01, 0x1E},  // s
+    {0x08, 0x08, 0x1C, 0x08, 0x08, 0x09, 0x06},  // t
+    {0x00, 0x00, 0x11, 0x11, 0x11, 0x13, 0x0D},  // u
+    {0x00, 0x00, 0x11, 0x11, 0x11, 0x0A, 0x04},  // v
+    {0x00, 0x00, 0x11, 0x11, 0x15, 0x15, 0x0A},  // w
+    {0x00, 0x00, 0x11, 0x0A, 0x04, 0x0A, 0x11},  // x
+    {0x00, 0x00, 0x11, 0x11, 0x0F, 0x01, 0x0E},  // y
+    {0x00, 0x00, 0x1F, 0x02, 0x04, 0x08, 0x1F},  // z
+    {0x02, 0x04, 0x04, 0x08, 0x04, 0x04, 0x02},  // {
+    {0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04},  // |
+    {0x08, 0x04, 0x04, 0x02, 0x04, 0x04, 0x08},  // }
+    {0x00, 0x00, 0x08, 0x15, 0x02, 0x00, 0x00},  // ~
+};
+
+static const int GLYPH_WIDTH = 5;
+static const int GLYPH_HEIGHT = 7;
+
+// the font is scaled by whole pixels: 1 up to size 13, 2 up to 20, ...
+static int fontScale(int size) {
+    return std::max(1, size / 7);
+}
+
+int textWidth(const std::string& text, int txtSize) {
+    int scale = fontScale(txtSize);
+    return text.empty() ? 0 : (int)text.size() * (GLYPH_WIDTH + 1) * scale - scale;
+}
+
+// An RGB image and the rectangle drawing is clipped to.
+class Framebuffer {
+public:
+    int width, height;
+    std::vector<unsigned char> pixels;  // rows of r, g, b from the top left
+
+    Framebuffer(int w, int h) : width(w), height(h), pixels((size_t)w * h * 3, 255) {
+        clipTo({0, 0, w, h});
+    }
+
+    void clipTo(const DrawList::Bounds& r) {
+        clipX0 = std::max(0, r.x);
+        clipY0 = std::max(0, r.y);
+        clipX1 = std::min(width, r.x + r.w);
+        clipY1 = std::min(height, r.y + r.h);
+    }
+
+    void setColor(unsigned char r, unsigned char g, unsigned char b) {
+        color[0] = r;
+        color[1] = g;
+        color[2] = b;
+    }
+
+    // [x0, x1) on row y
+    void span(int x0, int x1, int y) {
+        if (y < clipY0 || y >= clipY1) {
+            return;
+        }
+        x0 = std::max(x0, clipX0);
+        x1 = std::min(x1, clipX1);
+        if (x0 >= x1) {
+            return;
+        }
+        unsigned char* p = &pixels[((size_t)y * width + x0) * 3];
+        for (int x = x0; x < x1; x++, p += 3) {
+            p[0] = color[0];
+            p[1] = color[1];
+            p[2] = color[2];
+        }
+    }
+
+    void plot(int x, int y) {
+        span(x, x + 1, y);
+    }
+
+    void fillRect(int x, int y, int w, int h) {
+        if (x >= clipX1 || x + w <= clipX0) {
+            return;
+        }
+        for (int row = std::max(y, clipY0); row < std::min(y + h, clipY1); row++) {
+            span(x, x + w, row);
+        }
+    }
+
+    // the outline of the cells fillRect would fill
+    void rect(int x, int y, int w, int h) {
+        if (w <= 0 || h <= 0) {
+            return;
+        }
+        span(x, x + w, y);
+        span(x, x + w, y + h - 1);
+        for (int row = std::max(y + 1, clipY0); row < std::min(y + h - 1, clipY1); row++) {
+            plot(x, row);
+            plot(x + w - 1, row);
+        }
+    }
+
+    // The ellipse inscribed in the box, filled or as an outline.
+    void oval(int x, int y, int w, int h, bool filled) {
+        if (w <= 0 || h <= 0) {
+            return;
+        }
+        double cx = x + w / 2.0, cy = y + h / 2.0, rx = w / 2.0, ry = h / 2.0;
+        // each row's span, and for outlines each column's ends too, so steep
+        // parts of the curve have no gaps
+        for (int row = std::max(y, clipY0); row < std::min(y + h, clipY1); row++) {
+            double dy = (row + 0.5 - cy) / ry;
+            double dx = rx * std::sqrt(std::max(0.0, 1 - dy * dy));
+            int x0 = (int)std::lround(cx - dx), x1 = (int)std::lround(cx + dx);
+            if (filled) {
+                span(x0, x1, row);
+            } else if (x1 > x0) {
+                plot(x0, row);
+                plot(x1 - 1, row);
+            }
+        }
+        if (!filled) {
+            for (int col = std::max(x, clipX0); col < std::min(x + w, clipX1); col++) {
+                double dx = (col + 0.5 - cx) / rx;
+                double dy = ry * std::sqrt(std::max(0.0, 1 - dx * dx));
+                int y0 = (int)std::lround(cy - dy), y1 = (int)std::lround(cy + dy);
+                if (y1 > y0) {
+                    plot(col, y0);
+                    plot(col, y1 - 1);
+                }
+            }
+        }
+    }
+
+    void line(int x0, int y0, int x1, int y1) {
+        // Bresenham
+        int dx = std::abs(x1 - x0), sx = x0 < x1 ? 1 : -1;
+        int dy = -std::abs(y1 - y0), sy = y0 < y1 ? 1 : -1;
+        int err = dx + dy;
+        while (true) {
+            plot(x0, y0);
+            if (x0 == x1 && y0 == y1) {
+                break;
+            }
+            int e2 = 2 * err;
+            if (e2 >= dy) {
+                err += dy;
+                x0 += sx;
+            }
+            if (e2 <= dx) {
+                err += dx;
+                y0 += sy;
+            }
+        }
+    }
+
+    // w by h pixels of r, g, b
+    void image(const unsigned char* rgb, int x, int y, int w, int h) {
+        int x0 = std::max(x, clipX0), x1 = std::min(x + w, clipX1);
+        if (x0 >= x1) {
+            return;
+        }
+        for (int row = std::max(y, clipY0); row < std::min(y + h, clipY1); row++) {
+            memcpy(&pixels[((size_t)row * width + x0) * 3], rgb + ((size_t)(row - y) * w + (x0 - x)) * 3, (size_t)(x1 - x0) * 3);
+        }
+    }
+
+    // text with its baseline starting at x, y; characters outside ASCII
+    // 32-126 are drawn as '?'
+    void text(const char* s, int n, int x, int y, int size) {
+        int scale = fontScale(size);
+        int top = y - GLYPH_HEIGHT * scale;
+        if (top >= clipY1 || y <= clipY0) {
+            return;
+        }
+        label.assign(s, n);
+        for (const GlyphRun& run : glyphRuns.get(BUILTIN_FONT, GLYPH_HEIGHT, label, shape)) {
+            fillRect(x + run.x * scale, top + run.y * scale, run.length * scale, scale);
+        }
+    }
+
+private:
+    // Pixels x to x + length - 1 of row y of a label in the unscaled font,
+    // from its top left.
+    struct GlyphRun {
+        int x;
+        unsigned char y, length;
+    };
+
+    static const int BUILTIN_FONT = 0;
+
+    // a label's glyphs as runs of pixels, so drawing it again is a few
+    // fills
+    static std::vector<GlyphRun> shape(const std::string& text) {
+        std::vector<GlyphRun> runs;
+        for (size_t i = 0; i < text.size(); i++) {
+            unsigned char c = text[i];
+            const unsigned char* glyph = FONT_5X7[(c >= 32 && c < 127 ? c : '?') - 32];
+            for (int row = 0; row < GLYPH_HEIGHT; row++) {
+                for (int col = 0; col < GLYPH_WIDTH; col++) {
+                    if (!(glyph[row] & (0x10 >> col))) {
+                        continue;
+                    }
+                    int end = col;
+                    while (end < GLYPH_WIDTH && (glyph[row] & (0x10 >> end))) {
+                        end++;
+                    }
+                    runs.push_back({(int)i * (GLYPH_WIDTH + 1) + col, (unsigned char)row, (unsigned char)(end - col)});
+                    col = end;
+                }
+            }
+        }
+        return runs;
+    }
+
+    TextCache<std::vector<GlyphRun>> glyphRuns;
+    std::string label;  // the one being drawn, kept to reuse its buffer
+    int clipX0, clipY0, clipX1, clipY1;
+    unsigned char color[3] = {0, 0, 0};
+};
+
+// Encodes and writes frames on worker threads. submit() only copies the
+// frame; it waits if the workers fall more than two frames each behind.
+class FrameWriter {
+public:
+    FrameWriter(const std::string& pattern, unsigned threads) : pattern(pattern) {
+        // the frame number goes where the one %d (or %0Nd) is
+        size_t at = pattern.find('%');
+        size_t end = pattern.find('d', at);
+        if (at == std::string::npos || end == std::string::npos
+            || pattern.find_first_not_of("0123456789", at + 1) != end || pattern.find('%', end) != std::string::npos) {
+            error("Frame file pattern needs exactly one %d: " + pattern);
+        }
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        maxQueued = 2 * threads;
+        for (unsigned i = 0; i < threads; i++) {
+            workers.emplace_back(&FrameWriter::work, this);
+        }
+    }
+
+    ~FrameWriter() {
+        // too late to throw
+        std::string failure = finish();
+        if (!failure.empty()) {
+            std::cerr << failure << std::endl;
+        }
+    }
+
+    // Waits for the frames submitted so far to be written; returns why
+    // one couldn't be, or "".
+    std::string finish() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& t : workers) {
+            t.join();
+        }
+        workers.clear();
+        std::string why;
+        why.swap(failure);
+        return why;
+    }
+
+    void submit(const Framebuffer& frame, unsigned number) {
+        std::unique_lock<std::mutex> lock(mutex);
+        room.wait(lock, [this] { return queue.size() < maxQueued; });
+        if (!failure.empty()) {
+            error(failure);
+        }
+        Job job;
+        job.number = number;
+        job.width = frame.width;
+        job.height = frame.height;
+        // pixel buffers go round between the queue and spare
+        if (!spare.empty()) {
+            job.pixels.swap(spare.back());
+            spare.pop_back();
+        }
+        job.pixels.assign(frame.pixels.begin(), frame.pixels.end());
+        queue.push_back(std::move(job));
+        wake.notify_one();
+    }
+
+private:
+    struct Job {
+        unsigned number;
+        int width, height;
+        std::vector<unsigned char> pixels;
+    };
+
+    std::string pattern;
+    size_t maxQueued;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable room;
+    std::deque<Job> queue;
+    std::vector<std::vector<unsigned char>> spare;
+    std::string failure;
+    bool stopping = false;
+    std::vector<std::thread> workers;   // last, so it starts after everything it uses
+
+    std::string fileName(unsigned number) const {
+        std::vector<char> name(pattern.size() + 32);
+        snprintf(name.data(), name.size(), pattern.c_str(), number);
+        return name.data();
+    }
+
+    void work() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            wake.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (queue.empty()) {
+                return;
+            }
+            Job job = std::move(queue.front());
+            queue.pop_front();
+            room.notify_one();
+            lock.unlock();
+
+            std::string path = fileName(job.number);
+            std::string why;
+            try {
+                ImageWriter image(path, job.width);
+                for (int y = 0; y < job.height; y++) {
+                    image.writeRow(&job.pixels[(size_t)y * job.width * 3]);
+                }
+                image.close();
+            } catch (const ErrorException& e) {
+                why = e.what();
+            }
+
+            lock.lock();
+            if (!why.empty() && failure.empty()) {
+                failure = why;
+            }
+            spare.push_back(std::move(job.pixels));
+        }
+    }
+};
+
+// Simple window implementation
+class WindowImpl {
+public:
+    int width, height;
+    DrawList list;
+    Framebuffer frame;
+    std::vector<DrawList::Bounds> dirty;
+    std::string currentColor;
+    unsigned char currentRgb[3] = {0, 0, 0};    // currentColor, parsed
+    int fontSize = 14;
+    std::unique_ptr<FrameWriter> writer;
+    unsigned frameNumber = 0;
+    uint64_t maxFrames = 0;     // frames to record, 0 for no limit
+
+    WindowImpl(int width, int height) : width(width), height(height), frame(width, height), currentColor(BLACK) {}
+
+    // repaints what changed into the framebuffer
+    void render() {
+        bool all;
+        list.takeDamage(dirty, all);
+        if (all) {
+            dirty.assign(1, {0, 0, width, height});
+        }
+        mergeOverlapping(dirty);
+        for (const DrawList::Bounds& area : dirty) {
+            frame.clipTo(area);
+            frame.setColor(255, 255, 255);
+            frame.fillRect(area.x, area.y, area.w, area.h);
+            for (const DrawList::Group& group : list.getGroups()) {
+                if (!group.bounds.intersects(area)) {
+                    continue;
+                }
+                const unsigned char* pixels = group.pixels.data();
+                for (const DrawList::DrawCommand& cmd : group.commands) {
+                    if (!outside(cmd, area)) {
+                        draw(group, cmd, pixels);
+                    }
+                    if (cmd.shape == DrawList::Shape::Image) {
+                        pixels += (size_t)cmd.w * cmd.h * 3;
+                    }
+                }
+            }
+        }
+    }
+
+private:
+    // Replaces rects that overlap with their union, so nothing is painted
+    // twice.
+    static void mergeOverlapping(std::vector<DrawList::Bounds>& rects) {
+        for (size_t i = 0; i < rects.size(); i++) {
+            for (size_t j = i + 1; j < rects.size(); j++) {
+                DrawList::Bounds& a = rects[i];
+                const DrawList::Bounds& b = rects[j];
+                if (!a.intersects(b)) {
+                    continue;
+                }
+                int right = std::max(a.x + a.w, b.x + b.w);
+                int bottom = std::max(a.y + a.h, b.y + b.h);
+                a.x = std::min(a.x, b.x);
+                a.y = std::min(a.y, b.y);
+                a.w = right - a.x;
+                a.h = bottom - a.y;
+                rects[j] = rects.back();
+                rects.pop_back();
+                // the union may overlap rects already passed
+                j = i;
+            }
+        }
+    }
+
+    // true if cmd certainly draws nothing in area; labels are only known by
+    // their group's bounds
+    static bool outside(const DrawList::DrawCommand& cmd, const DrawList::Bounds& area) {
+        switch (cmd.shape) {
+            case DrawList::Shape::Text:
+                return false;
+            case DrawList::Shape::Line:
+                return std::max(cmd.x, cmd.w) < area.x || std::min(cmd.x, cmd.w) >= area.x + area.w
+                    || std::max(cmd.y, cmd.h) < area.y || std::min(cmd.y, cmd.h) >= area.y + area.h;
+            default:
+                return cmd.x >= area.x + area.w || cmd.x + cmd.w <= area.x || cmd.y >= area.y + area.h || cmd.y + cmd.h <= area.y;
+        }
+    }
+
+    // pixels are cmd's, if it is an Image
+    void draw(const DrawList::Group& group, const DrawList::DrawCommand& cmd, const unsigned char* pixels) {
+        frame.setColor(cmd.r, cmd.g, cmd.b);
+        switch (cmd.shape) {
+            case DrawList::Shape::FillRect: frame.fillRect(cmd.x, cmd.y, cmd.w, cmd.h); break;
+            case DrawList::Shape::Rect: frame.rect(cmd.x, cmd.y, cmd.w, cmd.h); break;
+            case DrawList::Shape::FillOval: frame.oval(cmd.x, cmd.y, cmd.w, cmd.h, true); break;
+            case DrawList::Shape::Oval: frame.oval(cmd.x, cmd.y, cmd.w, cmd.h, false); break;
+            case DrawList::Shape::Line: frame.line(cmd.x, cmd.y, cmd.w, cmd.h); break;
+            case DrawList::Shape::Text: frame.text(group.labels.data() + cmd.w, cmd.h, cmd.x, cmd.y, cmd.size); break;
+            case DrawList::Shape::Image: frame.image(pixels, cmd.x, cmd.y, cmd.w, cmd.h); break;
+        }
+    }
+};
+
+// Window implementation
+Window::Window(int width, int height, const std::string& /*title*/) : mImpl(new WindowImpl(width, height)) {
+}
+
+Window::~Window() = default;
+
+void Window::setTerminateOnClose(bool /*terminate*/) {
+}
+
+void Window::clear() {
+    mImpl->list.clear();
+}
+
+void Window::beginGroup(int id) {
+    mImpl->list.beginGroup(id);
+}
+
+void Window::endGroup() {
+    mImpl->list.endGroup();
+}
+
+void Window::setColor(const std::string& color) {
+    if (color == mImpl->currentColor) {
+        return;
+    }
+    mImpl->currentColor = resolveColor(color);
+    hexToRgb(mImpl->currentColor, mImpl->currentRgb[0], mImpl->currentRgb[1], mImpl->currentRgb[2]);
+}
+
+void Window::setFontSize(int size) {
+    mImpl->fontSize = std::max(1, std::min(size, 255));
+}
+
+std::string Window::getColor() const {
+    return mImpl->currentColor;
+}
+
+void Window::fillRect(int x, int y, int width, int height) {
+    mImpl->list.add(DrawList::Shape::FillRect, mImpl->currentRgb, x, y, width, height);
+}
+
+void Window::fillOval(int x, int y, int width, int height) {
+    mImpl->list.add(DrawList::Shape::FillOval, mImpl->currentRgb, x, y, width, height);
+}
+
+void Window::fillCircle(int centerX, int centerY, int radius) {
+    fillOval(centerX - radius, centerY - radius, radius * 2, radius * 2);
+}
+
+void Window::drawRect(int x, int y, int width, int height) {
+    mImpl->list.add(DrawList::Shape::Rect, mImpl->currentRgb, x, y, width, height);
+}
+
+void Window::drawOval(int x, int y, int width, int height) {
+    mImpl->list.add(DrawList::Shape::Oval, mImpl->currentRgb, x, y, width, height);
+}
+
+void Window::drawCircle(int centerX, int centerY, int radius) {
+    drawOval(centerX - radius, centerY - radius, radius * 2, radius * 2);
+}
+
+void Window::drawLine(int x0, int y0, int x1, int y1) {
+    mImpl->list.add(DrawList::Shape::Line, mImpl->currentRgb, x0, y0, x1, y1);
+}
+
+void Window::drawImage(const unsigned char* rgb, int x, int y, int width, int height) {
+    mImpl->list.addImage(rgb, x, y, width, height);
+}
+
+void Window::drawLabel(const std::string& text, int x, int y) {
+    // x and y are the start of the baseline
+    int glyphHeight = GLYPH_HEIGHT * fontScale(mImpl->fontSize);
+    DrawList::Bounds area = {x, y - glyphHeight, textWidth(text, mImpl->fontSize), glyphHeight};
+    mImpl->list.addText(text, mImpl->fontSize, mImpl->currentRgb, x, y, area);
+}
+
+int Window::getWidth() const {
+    return mImpl->width;
+}
+
+int Window::getHeight() const {
+    return mImpl->height;
+}
+
+bool Window::hasEvents() const {
+    return false;
+}
+
+Event Window::getEvent() {
+    Event emptyEvent;
+    emptyEvent.Type = EventType::None;
+    return emptyEvent;
+}
+
+void Window::update() {
+    if (!isOpen()) {
+        return;
+    }
+    mImpl->render();
+    if (mImpl->writer) {
+        mImpl->writer->submit(mImpl->frame, mImpl->frameNumber);
+    }
+    mImpl->frameNumber++;
+}
+
+bool Window::isOpen() const {
+    return mImpl->writer && (mImpl->maxFrames == 0 || mImpl->frameNumber < mImpl->maxFrames);
+}
+
+void Window::recordFrames(const std::string& pattern, unsigned threads, uint64_t maxFrames) {
+    if (mImpl->writer) {
+        std::string failure = mImpl->writer->finish();
+        mImpl->writer.reset();
+        if (!failure.empty()) {
+            error(failure);
+        }
+    }
+    if (!pattern.empty()) {
+        mImpl->writer.reset(new FrameWriter(pattern, threads));
+    }
+    mImpl->frameNumber = 0;
+    mImpl->maxFrames = maxFrames;
+}
+
+// Terminal implementation: text goes to standard output
+class TerminalImpl {
+};
+
+Terminal::Terminal(int /*width*/, int /*height*/, const std::string& /*title*/) : mImpl(new TerminalImpl()) {
+}
+
+Terminal::~Terminal() = default;
+
+void Terminal::setTerminateOnClose(bool /*terminate*/) {
+}
+
+void Terminal::clear() {
+}
+
+void Terminal::setText(const std::string& text) {
+    std::cout << text << std::flush;
+}
+
+void Terminal::appendText(const std::string& text) {
+    std::cout << text << std::flush;
+}
+
+void Terminal::showCursor(bool /*show*/) {
+}
+
+bool Terminal::hasEvents() const {
+    return false;
+}
+
+Event Terminal::getEvent() {
+    Event emptyEvent;
+    emptyEvent.Type = EventType::None;
+    return emptyEvent;
+}
+
+bool Terminal::isOpen() const {
+    return true;
+}
+
+} // namespace graphics
@@ -0,0 +1,69 @@
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "../src/TuringMachine/programFormat.hpp"
+
+// Encoded programs: a round trip, and files that are truncated or claim
+// more states than decodeProgram accepts, which must throw
+// std::invalid_argument rather than allocate or read past the end.
+
+static int failures = 0;
+
+static void check(bool ok, const std::string& what){
+    if (!ok){
+        std::cerr << "FAIL: " << what << "\n";
+        failures++;
+    }
+}
+
+static bool rejects(const std::string& data){
+    try{
+        decodeProgram(data);
+    }
+    catch (const std::invalid_argument&){
+        return true;
+    }
+    return false;
+}
+
+static std::string header(uint64_t flags, uint64_t states, uint64_t start){
+    std::string out(PROGRAM_MAGIC, sizeof(PROGRAM_MAGIC));
+    putVarint(out, flags);
+    putVarint(out, states);
+    putVarint(out, start);
+    return out;
+}
+
+int main(){
+    const std::string description =
+        "A - S_ - S1 - R - B;\n"
+        "A - S1 - S0 - L - HALT;\n"
+        "B - S_ - S0 - L - A;\n";
+    Tape tape;
+    std::unique_ptr<TM> machine(TM::fromStandardDescription(std::string_view(description), tape, 1000));
+    const std::string encoded = encodeProgram(*machine->getProgram());
+    Program decoded = decodeProgram(encoded);
+    check(encodeProgram(decoded) == encoded, "encoded program changes on a round trip");
+
+    for (size_t size = 0; size < encoded.size(); size++){
+        check(rejects(encoded.substr(0, size)), "accepts the encoding cut to " + std::to_string(size) + " bytes");
+    }
+
+    // unnamed, so the state count isn't bounded by any names
+    std::string oversized = header(0, 0x7FFFFFFC, 0);
+    putVarint(oversized, 0);
+    check(rejects(oversized), "accepts 0x7FFFFFFC unnamed states");
+    std::string justOver = header(0, MAX_ENCODED_STATES + 1, 0);
+    putVarint(justOver, 0);
+    check(rejects(justOver), "accepts MAX_ENCODED_STATES + 1 states");
+    std::string named = header(1, 1000, 0);
+    putVarint(named, 0);
+    check(rejects(named), "accepts 1000 named states in a few bytes");
+
+    if (failures == 0){
+        std::cout << "programFormat: ok\n";
+    }
+    return failures == 0 ? 0 : 1;
+}
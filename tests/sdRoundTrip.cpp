@@ -0,0 +1,64 @@
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "../src/TuringMachine/turingMachine.hpp"
+
+// Standard description round trip: a machine that jumps to a state with no
+// transitions must reload from its fullSD still stopping on an undefined
+// transition, not halting, and emit the same description again.
+
+static int failures = 0;
+
+static void check(bool ok, const std::string& what){
+    if (!ok){
+        std::cerr << "FAIL: " << what << "\n";
+        failures++;
+    }
+}
+
+static RunResult run(TM& tm, Tape& tape){
+    std::shared_ptr<const Program> prog = tm.getProgram();
+    uint32_t state = prog->start;
+    return execute(*prog, tape, state, 1000, 1000);
+}
+
+int main(){
+    // B jumps to C, which is never defined; A's S1 transition halts
+    const std::string description =
+        "A - S_ - S1 - R - B;\n"
+        "A - S1 - S0 - L - HALT;\n"
+        "B - S_ - S0 - L - C;\n";
+
+    Tape tape;
+    std::unique_ptr<TM> original(TM::fromStandardDescription(std::string_view(description), tape, 1000));
+    const std::string sd = original->getFullSD();
+
+    Tape reloadedTape;
+    std::unique_ptr<TM> reloaded(TM::fromSD(sd, reloadedTape, 1000));
+    check(reloaded->getFullSD() == sd, "fullSD changes on reload: " + sd + " vs " + reloaded->getFullSD());
+
+    Tape first, second;
+    RunResult before = run(*original, first);
+    RunResult after = run(*reloaded, second);
+    check(before.reason == HaltReason::Undefined, std::string("original stops as ") + haltReasonName(before.reason));
+    check(after.reason == HaltReason::Undefined, std::string("reloaded stops as ") + haltReasonName(after.reason));
+    check(before.steps == 2 && after.steps == 2, "step counts differ from 2");
+
+    // HALT is state 0 and has no transitions of its own
+    bool rejected = false;
+    try{
+        Tape t;
+        delete TM::fromSD("DDADAARDC", t, 1000);
+    }
+    catch (const std::invalid_argument&){
+        rejected = true;
+    }
+    check(rejected, "a row defining HALT is accepted");
+
+    if (failures == 0){
+        std::cout << "sdRoundTrip: ok (" << sd << ")\n";
+    }
+    return failures == 0 ? 0 : 1;
+}